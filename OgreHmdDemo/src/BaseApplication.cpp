@@ -16,19 +16,28 @@
  -----------------------------------------------------------------------------
  */
 #include "BaseApplication.h"
+#include <OgreTextureManager.h>
+#include <OgreHardwarePixelBuffer.h>
+#include <OgreArchiveManager.h>
+#include <ctime>
 
 #define CAMERA "PlayerCam"
+#define SCRIPTS_GROUP "Scripts"
 
 using namespace Ogre;
 
 namespace HMD {
 //-------------------------------------------------------------------------------------
 BaseApplication::BaseApplication(void) :
-		mRoot(0), mSceneMgr(0), mWindow(0), mResourcesCfg(StringUtil::BLANK),
+		mRoot(0), mSceneMgr(0), mWindow(0), mRenderTarget(0), mBenchmark(0),
+		mGoldenImageCheck(0), mBuildShaderCache(false), mStartTime(0),
+		mScriptLoader(0), mPackArchiveFactory(0),
+		mResourcesCfg(StringUtil::BLANK),
 		mPluginsCfg(Ogre::StringUtil::BLANK), mShutDown(false),
 		mInputManager(0), mMouse(0), mKeyboard(0),
 		mBodyNode(0), mCameraNode(0), mMove(100), mRotate(0.1),
-		mCameraRotation(), mDirection() {
+		mCameraRotation(), mDirection(), mFramePacer(0), mMaxFramesAhead(1),
+		mRefreshRate(0), mQualityGovernor(0), mFrameRecorder(0), mRenderProfiler(0), mSwapStart(0) {
 }
 
 //-------------------------------------------------------------------------------------
@@ -36,11 +45,58 @@ BaseApplication::~BaseApplication(void) {
 	// Remove ourself as a Window listener
 	WindowEventUtilities::removeWindowEventListener(mWindow, this);
 	windowClosed(mWindow);
+	delete mFrameRecorder;
+	delete mQualityGovernor;
+	delete mFramePacer;
+	delete mRenderProfiler;
+
+	if (mScriptLoader)
+		MeshManager::getSingleton().setListener(0);
+	delete mScriptLoader;
 	delete mRoot;
+	// the archives are destroyed by the root
+	delete mPackArchiveFactory;
 }
 
 //-------------------------------------------------------------------------------------
 bool BaseApplication::configure(void) {
+	if (mBenchmark || mGoldenImageCheck || mBuildShaderCache) {
+		// Fixed configuration, works with a software GL driver (e.g. LIBGL_ALWAYS_SOFTWARE=1)
+		RenderSystem* rs = mRoot->getRenderSystemByName("OpenGL Rendering Subsystem");
+		if (!rs)
+			OGRE_EXCEPT(Exception::ERR_ITEM_NOT_FOUND, "Headless modes need the OpenGL render system, check "
+					+ mPluginsCfg, "BaseApplication::configure");
+
+		rs->setConfigOption("Full Screen", "No");
+		rs->setConfigOption("VSync", "No");
+		rs->setConfigOption("FSAA", "0");
+		mRoot->setRenderSystem(rs);
+		mRoot->initialise(false);
+
+		// GL needs a window for its context, the frames are rendered offscreen
+		NameValuePairList params;
+		params["hidden"] = "true";
+		mWindow = mRoot->createRenderWindow("Benchmark Window", 64, 64, false, &params);
+		mWindow->setAutoUpdated(false);
+
+		unsigned int width = 64, height = 64;
+
+		if (mBenchmark) {
+			width = mBenchmark->getWidth();
+			height = mBenchmark->getHeight();
+		} else if (mGoldenImageCheck) {
+			width = mGoldenImageCheck->getWidth();
+			height = mGoldenImageCheck->getHeight();
+		}
+
+		TexturePtr target = TextureManager::getSingleton().createManual("BenchmarkTarget",
+				ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, TEX_TYPE_2D,
+				width, height, 0, PF_R8G8B8, TU_RENDERTARGET);
+		mRenderTarget = target->getBuffer()->getRenderTarget();
+
+		return true;
+	}
+
 	// Show the configuration dialog and initialise the system
 	// You can skip this and use root.restoreConfig() to load configuration
 	// settings if you were sure there are valid ones saved in ogre.cfg
@@ -48,6 +104,7 @@ bool BaseApplication::configure(void) {
 		// If returned true, user clicked OK so initialise
 		// Here we choose to let the system create a default rendering window by passing 'true'
 		mWindow = mRoot->initialise(true, "TutorialApplication Render Window");
+		mRenderTarget = mWindow;
 
 		return true;
 	} else {
@@ -74,7 +131,7 @@ void BaseApplication::destroyScene(void) {
 void BaseApplication::createViewports(void) {
 	// Create one viewport, entire window
 	Camera* camera = mSceneMgr->getCamera(CAMERA);
-	Viewport* vp = mWindow->addViewport(camera);
+	Viewport* vp = mRenderTarget->addViewport(camera);
 	vp->setBackgroundColour(Ogre::ColourValue(0, 0, 0));
 
 	// Alter the camera aspect ratio to match the viewport
@@ -121,7 +178,33 @@ void BaseApplication::createResourceListener(void) {
 }
 //-------------------------------------------------------------------------------------
 void BaseApplication::loadResources(void) {
-	ResourceGroupManager::getSingleton().initialiseAllResourceGroups();
+	ResourceGroupManager &rgm = ResourceGroupManager::getSingleton();
+	StringVector groups = rgm.getResourceGroups();
+
+	mShaderCache.load();
+
+	// Everything but the scripts, which are only parsed when they are referenced
+	for (size_t i = 0; i < groups.size(); i++) {
+		if (groups[i] != SCRIPTS_GROUP)
+			rgm.initialiseResourceGroup(groups[i]);
+	}
+
+	mScriptLoader = new LazyScriptLoader(SCRIPTS_GROUP, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+	MeshManager::getSingleton().setListener(mScriptLoader);
+}
+//-------------------------------------------------------------------------------------
+void BaseApplication::buildShaderCache(void) {
+	// Warm-up step, e.g. at install time: the next start finds all programs compiled
+	Profiler &profiler = Profiler::getSingleton();
+	unsigned long start = profiler.now();
+
+	// the scripts are parsed on demand, parse all of them to compile every program
+	mScriptLoader->ensureAll();
+	mShaderCache.warmUp();
+	mShaderCache.save();
+
+	LogManager::getSingleton().logMessage("Shader cache: compiled all programs in "
+			+ StringConverter::toString((profiler.now() - start) / 1000) + " ms");
 }
 //-------------------------------------------------------------------------------------
 void BaseApplication::go(void) {
@@ -139,23 +222,145 @@ void BaseApplication::go(void) {
 	mPluginsCfg = workingDir + mPluginsCfg;
 #endif
 
+	mStartTime = Profiler::getSingleton().now();
+
 	if (!setup())
 		return;
 
-	mRoot->startRendering();
+	if (mBuildShaderCache)
+		buildShaderCache();
+	else if (mBenchmark)
+		benchmarkLoop();
+	else if (mGoldenImageCheck)
+		goldenImageLoop();
+	else
+		renderLoop();
+
+	// keep programs compiled on demand for the next start
+	mShaderCache.save();
 
 	// clean up
 	destroyScene();
 }
 //-------------------------------------------------------------------------------------
+void BaseApplication::renderLoop(void) {
+	// Replaces mRoot->startRendering() which lets the driver queue frames ahead
+	mFramePacer = new FramePacer(mMaxFramesAhead, mRefreshRate);
+	mQualityGovernor = new QualityGovernor(mSceneMgr, mRefreshRate);
+	Profiler &profiler = Profiler::getSingleton();
+
+	mRoot->getRenderSystem()->_initRenderTargets();
+	mRoot->clearEventTimes();
+
+	while (true) {
+		HMD_PROFILE("frame");
+		unsigned long frameStart = profiler.now();
+		unsigned long waitStart, waitEnd;
+		WindowEventUtilities::messagePump();
+
+		{
+			HMD_PROFILE("throttle");
+			mFramePacer->throttle();
+		}
+		{
+			HMD_PROFILE("poseWait");
+			waitStart = profiler.now();
+			mFramePacer->waitForPoseDeadline();
+			waitEnd = profiler.now();
+		}
+		{
+			HMD_PROFILE("pose");
+			applyHeadPose();
+			mFramePacer->poseSampled();
+		}
+
+		if (!mRoot->renderOneFrame())
+			break;
+
+		mFramePacer->frameSubmitted();
+
+		// the wait for the pose deadline is idle time, not cost of the frame
+		mQualityGovernor->addFrame(profiler.now() - frameStart - (waitEnd - waitStart));
+	}
+}
+//-------------------------------------------------------------------------------------
+void BaseApplication::benchmarkLoop(void) {
+	// Frames are rendered as fast as possible but never queued ahead, so that
+	// the measured time per frame includes the GPU work
+	mFramePacer = new FramePacer(1, mRefreshRate);
+	Profiler &profiler = Profiler::getSingleton();
+
+	mRoot->getRenderSystem()->_initRenderTargets();
+	mRoot->clearEventTimes();
+
+	for (size_t frame = 0; frame < mBenchmark->getFrameCount(); frame++) {
+		unsigned long start = profiler.now();
+		WindowEventUtilities::messagePump();
+
+		mFramePacer->throttle();
+		mBenchmark->applyFrame(frame, mBodyNode, &mCameraRotation);
+		applyHeadPose();
+		mFramePacer->poseSampled();
+
+		if (!mRoot->renderOneFrame(mBenchmark->getTimeStep()))
+			break;
+
+		mFramePacer->frameSubmitted();
+		mBenchmark->addFrameTime(profiler.now() - start);
+	}
+
+	mBenchmark->writeReport(mRoot->getRenderSystem()->getName());
+}
+//-------------------------------------------------------------------------------------
+void BaseApplication::goldenImageLoop(void) {
+	mRoot->getRenderSystem()->_initRenderTargets();
+	mRoot->clearEventTimes();
+
+	for (size_t pose = 0; pose < mGoldenImageCheck->getPoseCount(); pose++) {
+		Benchmark::applyKeyframe(mGoldenImageCheck->getPose(pose), mBodyNode, &mCameraRotation);
+		applyHeadPose();
+
+		// A zero time step keeps animated materials (sky) at the same state.
+		// The first frame after a pose change creates the compositor resources
+		// and is discarded
+		for (int i = 0; i < 2; i++) {
+			WindowEventUtilities::messagePump();
+
+			if (!mRoot->renderOneFrame(0)) {
+				// the remaining poses are not checked either
+				for (; pose < mGoldenImageCheck->getPoseCount(); pose++)
+					mGoldenImageCheck->frameFailed(pose);
+				return;
+			}
+		}
+
+		mGoldenImageCheck->processFrame(pose, mRenderTarget);
+	}
+}
+//-------------------------------------------------------------------------------------
+void BaseApplication::applyHeadPose(void) {
+	mCameraNode->setOrientation(mCameraRotation);
+}
+//-------------------------------------------------------------------------------------
 bool BaseApplication::setup(void) {
 	mRoot = new Root(mPluginsCfg);
 
+	// "Pack" resource locations, see resources_pack.cfg
+	mPackArchiveFactory = new PackArchiveFactory();
+	ArchiveManager::getSingleton().addArchiveFactory(mPackArchiveFactory);
+
 	setupResources();
 
 	if (!configure())
 		return false;
 
+	if (mRefreshRate <= 0)
+		mRefreshRate = detectRefreshRate();
+	LogManager::getSingleton().logMessage("Frame pacing: " + StringConverter::toString(mRefreshRate)
+			+ " Hz, " + StringConverter::toString(mMaxFramesAhead) + " frame(s) ahead");
+
+	mRenderProfiler = new RenderProfiler(mRenderTarget);
+
 	chooseSceneManager();
 	createBodyAndCameraNodes();
 	createCameras();
@@ -176,6 +381,23 @@ bool BaseApplication::setup(void) {
 	return true;
 }
 //-------------------------------------------------------------------------------------
+Real BaseApplication::detectRefreshRate(void) {
+	// The GL render system reports the mode of the window as "60 Hz" (or
+	// "60 MHz" on GLX), without a display mode the rate is not known
+	ConfigOptionMap &options = mRoot->getRenderSystem()->getConfigOptions();
+	ConfigOptionMap::iterator frequency = options.find("Display Frequency");
+
+	if (frequency != options.end()) {
+		Real rate = StringConverter::parseReal(StringUtil::split(frequency->second.currentValue, " ").front());
+
+		if (rate > 0)
+			return rate;
+	}
+
+	LogManager::getSingleton().logMessage("Refresh rate unknown, assuming 60 Hz (set it with --refresh)");
+	return 60;
+}
+//-------------------------------------------------------------------------------------
 void BaseApplication::createBodyAndCameraNodes() {
 	SceneNode* rootNode = mSceneMgr->getRootSceneNode();
 	mBodyNode = rootNode->createChildSceneNode("BodyNode", Vector3(0, 50, 200));
@@ -183,6 +405,16 @@ void BaseApplication::createBodyAndCameraNodes() {
 }
 //-------------------------------------------------------------------------------------
 void BaseApplication::createFrameListener(void) {
+	mDirection.x = mDirection.y = mDirection.z = 0;
+	mCameraRotation.x = mCameraRotation.y = mCameraRotation.z = 0;
+	mCameraRotation.w = 1;
+
+	if (mBenchmark || mGoldenImageCheck || mBuildShaderCache) {
+		// no input, the benchmark or the golden image check drives body and head
+		mRoot->addFrameListener(this);
+		return;
+	}
+
 	LogManager::getSingletonPtr()->logMessage("*** Initializing OIS ***");
 	OIS::ParamList pl;
 	size_t windowHnd = 0;
@@ -200,17 +432,16 @@ void BaseApplication::createFrameListener(void) {
 	mMouse->setEventCallback(this);
 	mKeyboard->setEventCallback(this);
 
-	mDirection.x = mDirection.y = mDirection.z = 0;
-
 	//Set initial mouse clipping size
 	windowResized(mWindow);
 
-	mCameraRotation.x = mCameraRotation.y = mCameraRotation.z = 0;
-	mCameraRotation.w = 1;
-
 	//Register as a Window listener
 	WindowEventUtilities::addWindowEventListener(mWindow, this);
 
+	mFrameRecorder = new FrameRecorder(mWindow, mRefreshRate);
+	if (!mRecordOutput.empty())
+		mFrameRecorder->start(mRecordOutput);
+
 	mRoot->addFrameListener(this);
 }
 //-------------------------------------------------------------------------------------
@@ -221,16 +452,49 @@ bool BaseApplication::frameRenderingQueued(const FrameEvent& evt) {
 	if (mShutDown)
 		return false;
 
-	//Need to capture/update each device
-	mKeyboard->capture();
-	mMouse->capture();
+	HMD_PROFILE("frameRenderingQueued");
+
+	if (mInputManager) {
+		HMD_PROFILE("input");
+		//Need to capture/update each device
+		mKeyboard->capture();
+		mMouse->capture();
+	}
 
 	mBodyNode->translate(mDirection * evt.timeSinceLastFrame, Node::TS_LOCAL);
-	mCameraNode->setOrientation(mCameraRotation);
+
+	// the back buffer holds the finished frame until the swap
+	if (mFrameRecorder)
+		mFrameRecorder->frameRendered();
+
+	// the buffers are swapped between frameRenderingQueued and frameEnded
+	mSwapStart = Profiler::getSingleton().now();
+
+	return true;
+}
+//-------------------------------------------------------------------------------------
+bool BaseApplication::frameEnded(const FrameEvent& evt) {
+	Profiler &profiler = Profiler::getSingleton();
+	profiler.record("swap", mSwapStart, profiler.now() - mSwapStart);
+
+	if (mStartTime) {
+		unsigned long startup = (profiler.now() - mStartTime) / 1000;
+
+		LogManager::getSingleton().logMessage("Startup: first frame after " + StringConverter::toString(startup)
+				+ " ms, shader cache " + (mShaderCache.isWarm() ? "warm" : "cold"));
+		profiler.setCounter(mShaderCache.isWarm() ? "startupWarmMs" : "startupColdMs", startup);
+		mStartTime = 0;
+	}
 
 	return true;
 }
 //-------------------------------------------------------------------------------------
+void BaseApplication::dumpFrameTimings(void) {
+	Profiler &profiler = Profiler::getSingleton();
+	profiler.logStats();
+	profiler.writeChromeTrace("trace_" + StringConverter::toString((unsigned long) time(0)) + ".json");
+}
+//-------------------------------------------------------------------------------------
 bool BaseApplication::keyPressed(const OIS::KeyEvent &evt) {
 	switch (evt.key) {
 		case OIS::KC_UP:
@@ -258,7 +522,21 @@ bool BaseApplication::keyPressed(const OIS::KeyEvent &evt) {
 			mDirection.y = mMove;
 			break;
 		case OIS::KC_SYSRQ: // take a screenshot
-			mWindow->writeContentsToTimestampedFile("screenshot", ".jpg");
+			mFrameRecorder->captureScreenshot();
+			break;
+		case OIS::KC_C: // start or stop recording
+			if (mFrameRecorder->isRecording())
+				mFrameRecorder->stop();
+			else
+				mFrameRecorder->start(mRecordOutput.empty()
+						? "recording_" + StringConverter::toString((unsigned long) time(0)) : mRecordOutput);
+			break;
+		case OIS::KC_T: // log frame timing percentiles and write a Chrome trace
+			dumpFrameTimings();
+			break;
+		case OIS::KC_G: // toggle the quality governor, off restores full quality
+			if (mQualityGovernor)
+				mQualityGovernor->setEnabled(!mQualityGovernor->isEnabled());
 			break;
 		case OIS::KC_ESCAPE: // exit application
 			mShutDown = true;
@@ -317,6 +595,9 @@ bool BaseApplication::mouseReleased(const OIS::MouseEvent &evt,
 
 //Adjust mouse clipping area
 void BaseApplication::windowResized(RenderWindow* rw) {
+	if (!mMouse)
+		return;
+
 	unsigned int width, height, depth;
 	int left, top;
 	rw->getMetrics(width, height, depth, left, top);
@@ -44,6 +44,16 @@
 #   include <macUtils.h>
 #endif
 
+#include "FramePacer.h"
+#include "FrameRecorder.h"
+#include "QualityGovernor.h"
+#include "RenderProfiler.h"
+#include "Benchmark.h"
+#include "GoldenImageCheck.h"
+#include "ShaderCache.h"
+#include "LazyScriptLoader.h"
+#include "PackArchive.h"
+
 namespace HMD {
 
 #ifdef OGRE_IS_IOS
@@ -61,9 +71,22 @@ public:
 	virtual ~BaseApplication(void);
 
 	virtual void go(void);
+	// Runs the scripted benchmark instead of the interactive demo
+	void setBenchmark(Benchmark* benchmark) { mBenchmark = benchmark; }
+	// Renders the golden image poses instead of the interactive demo
+	void setGoldenImageCheck(GoldenImageCheck* check) { mGoldenImageCheck = check; }
+	// Only compiles all GPU programs into the shader cache and exits
+	void setBuildShaderCache(bool build) { mBuildShaderCache = build; }
+	// Starts recording right away, to a directory of frames or a video file
+	void setRecordOutput(const Ogre::String &output) { mRecordOutput = output; }
+	// Frames the CPU may run ahead of the GPU in the interactive loop
+	void setMaxFramesAhead(unsigned int frames) { mMaxFramesAhead = frames; }
+	// Display refresh rate in Hz, 0 takes it from the render window configuration
+	void setRefreshRate(Ogre::Real rate) { mRefreshRate = rate; }
 
 	// Ogre::FrameListener
 	virtual bool frameRenderingQueued(const Ogre::FrameEvent& evt);
+	virtual bool frameEnded(const Ogre::FrameEvent& evt);
 
 protected:
 	virtual bool setup();
@@ -78,6 +101,13 @@ protected:
 	virtual void setupResources(void);
 	virtual void createResourceListener(void);
 	virtual void loadResources(void);
+	virtual void buildShaderCache(void);
+	virtual void renderLoop(void);
+	virtual void benchmarkLoop(void);
+	virtual void goldenImageLoop(void);
+	virtual void applyHeadPose(void);
+	virtual void dumpFrameTimings(void);
+	virtual Ogre::Real detectRefreshRate(void);
 
 	// OIS::KeyListener
 	virtual bool keyPressed(const OIS::KeyEvent &evt);
@@ -95,6 +125,17 @@ protected:
 	Ogre::Root *mRoot;
 	Ogre::SceneManager* mSceneMgr;
 	Ogre::RenderWindow* mWindow;
+	// Target of the viewports: the window or an offscreen texture when headless
+	Ogre::RenderTarget* mRenderTarget;
+	Benchmark* mBenchmark;
+	GoldenImageCheck* mGoldenImageCheck;
+	bool mBuildShaderCache;
+	ShaderCache mShaderCache;
+	// Parses the scripts of the "Scripts" resource group on demand
+	LazyScriptLoader* mScriptLoader;
+	PackArchiveFactory* mPackArchiveFactory;
+	// Time go() was called, reset once the first frame is shown
+	unsigned long mStartTime;
 	Ogre::String mResourcesCfg;
 	Ogre::String mPluginsCfg;
 	Ogre::SceneNode* mBodyNode;
@@ -106,6 +147,21 @@ protected:
 
 	bool mShutDown;
 
+	// Frame pacing: CPU run-ahead limit and display refresh rate
+	FramePacer* mFramePacer;
+	unsigned int mMaxFramesAhead;
+	Ogre::Real mRefreshRate;
+	// Trades rendering quality for frame time in the interactive loop
+	QualityGovernor* mQualityGovernor;
+
+	// Screenshots and recordings, key C starts and stops recording
+	FrameRecorder* mFrameRecorder;
+	Ogre::String mRecordOutput;
+
+	// Frame timing instrumentation
+	RenderProfiler* mRenderProfiler;
+	unsigned long mSwapStart;
+
 	//OIS Input devices
 	OIS::InputManager* mInputManager;
 	OIS::Mouse* mMouse;
@@ -0,0 +1,138 @@
+#include "Benchmark.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <fstream>
+
+#define DEFAULT_FRAMES 960
+#define WARMUP_FRAMES 30
+
+namespace HMD {
+
+Benchmark::Benchmark() :
+		mFrameCount(DEFAULT_FRAMES), mWarmupFrames(WARMUP_FRAMES),
+		mWidth(1280), mHeight(800), mTimeStep(1.0f / 60.0f),
+		mReportFile("benchmark.json") {
+	// default path: a walk around the ogre heads looking around
+	mPath.push_back(createKeyframe(0, Vector3(0, 50, 200), 0, 0, 0, 0));
+	mPath.push_back(createKeyframe(4, Vector3(0, 50, -400), 0, 30, 0, 0));
+	mPath.push_back(createKeyframe(8, Vector3(600, 80, -400), -90, 0, -10, 5));
+	mPath.push_back(createKeyframe(12, Vector3(600, 50, 400), -180, -40, 10, 0));
+	mPath.push_back(createKeyframe(16, Vector3(0, 50, 200), -360, 0, 0, 0));
+}
+
+Benchmark::Keyframe Benchmark::createKeyframe(Real time, const Vector3 &position, Real bodyYaw, Real headYaw, Real headPitch, Real headRoll) {
+	Keyframe k;
+	k.time = time;
+	k.position = position;
+	k.bodyYaw = Degree(bodyYaw);
+	k.headYaw = Degree(headYaw);
+	k.headPitch = Degree(headPitch);
+	k.headRoll = Degree(headRoll);
+	return k;
+}
+
+void Benchmark::loadPath(const String &fileName) {
+	std::ifstream in(fileName.c_str());
+	Real t, x, y, z, bodyYaw, headYaw, headPitch, headRoll;
+
+	if (!in)
+		OGRE_EXCEPT(Exception::ERR_FILE_NOT_FOUND, "Cannot open camera path " + fileName, "Benchmark::loadPath");
+
+	mPath.clear();
+
+	while (in >> t >> x >> y >> z >> bodyYaw >> headYaw >> headPitch >> headRoll) {
+		// applyFrame loops over the path by the time of the last keyframe
+		if (mPath.empty() ? t < 0 : t <= mPath.back().time)
+			OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Camera path keyframe times must start at 0 or later and increase, "
+					+ StringConverter::toString(t) + " in " + fileName, "Benchmark::loadPath");
+
+		mPath.push_back(createKeyframe(t, Vector3(x, y, z), bodyYaw, headYaw, headPitch, headRoll));
+	}
+
+	if (mPath.size() < 2)
+		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Camera path needs at least two keyframes", "Benchmark::loadPath");
+}
+
+void Benchmark::applyFrame(size_t frame, SceneNode *bodyNode, Quaternion *headRotation) {
+	// the path is looped, with a fixed time step every run renders the same frames
+	Real duration = mPath.back().time;
+	Real time = std::fmod(frame * mTimeStep, duration);
+	size_t i = 1;
+
+	while (i < mPath.size() - 1 && mPath[i].time < time)
+		i++;
+
+	const Keyframe &a = mPath[i - 1];
+	const Keyframe &b = mPath[i];
+	Real s = (time - a.time) / std::max(b.time - a.time, Real(0.0001));
+	Keyframe k;
+
+	k.time = time;
+	k.position = a.position + (b.position - a.position) * s;
+	k.bodyYaw = a.bodyYaw + (b.bodyYaw - a.bodyYaw) * s;
+	k.headYaw = a.headYaw + (b.headYaw - a.headYaw) * s;
+	k.headPitch = a.headPitch + (b.headPitch - a.headPitch) * s;
+	k.headRoll = a.headRoll + (b.headRoll - a.headRoll) * s;
+
+	applyKeyframe(k, bodyNode, headRotation);
+}
+
+void Benchmark::applyKeyframe(const Keyframe &keyframe, SceneNode *bodyNode, Quaternion *headRotation) {
+	bodyNode->setPosition(keyframe.position);
+	bodyNode->setOrientation(Quaternion(keyframe.bodyYaw, Vector3::UNIT_Y));
+
+	Quaternion yaw(keyframe.headYaw, Vector3::UNIT_Y);
+	Quaternion pitch(keyframe.headPitch, Vector3::UNIT_X);
+	Quaternion roll(keyframe.headRoll, Vector3::UNIT_Z);
+	*headRotation = yaw * pitch * roll;
+}
+
+void Benchmark::addFrameTime(unsigned long microseconds) {
+	mFrameTimes.push_back(microseconds);
+}
+
+static Real percentile(const std::vector<unsigned long> &sorted, Real p) {
+	return sorted[std::min(sorted.size() - 1, (size_t) (p * sorted.size()))] / 1000.0f;
+}
+
+void Benchmark::writeReport(const String &renderSystem) {
+	std::vector<unsigned long> sorted(mFrameTimes.begin() + std::min(mWarmupFrames, mFrameTimes.size()), mFrameTimes.end());
+	std::ofstream out(mReportFile.c_str());
+	Real total = 0;
+
+	if (sorted.empty())
+		OGRE_EXCEPT(Exception::ERR_INVALID_STATE, "No frames measured", "Benchmark::writeReport");
+
+	std::sort(sorted.begin(), sorted.end());
+
+	for (size_t i = 0; i < sorted.size(); i++)
+		total += sorted[i] / 1000.0f;
+
+	Real mean = total / sorted.size();
+
+	out << "{\n\t\"renderSystem\": \"" << renderSystem << "\",\n"
+			<< "\t\"resolution\": [" << mWidth << ", " << mHeight << "],\n"
+			<< "\t\"frames\": " << sorted.size() << ",\n"
+			<< "\t\"warmupFrames\": " << mFrameTimes.size() - sorted.size() << ",\n"
+			<< "\t\"fps\": " << 1000.0f / mean << ",\n"
+			<< "\t\"frameTimeMs\": {\"min\": " << sorted.front() / 1000.0f << ", \"mean\": " << mean
+			<< ", \"p50\": " << percentile(sorted, 0.5f) << ", \"p95\": " << percentile(sorted, 0.95f)
+			<< ", \"p99\": " << percentile(sorted, 0.99f) << ", \"max\": " << sorted.back() / 1000.0f << "},\n"
+			<< "\t\"phasesMs\": {";
+
+	// per phase percentiles from the instrumentation
+	std::map<String, Profiler::Stats> phases = Profiler::getSingleton().getStats();
+
+	for (std::map<String, Profiler::Stats>::iterator it = phases.begin(); it != phases.end(); ++it) {
+		const Profiler::Stats &s = it->second;
+		out << (it == phases.begin() ? "\n" : ",\n") << "\t\t\"" << it->first << "\": {\"p50\": " << s.p50
+				<< ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99 << ", \"max\": " << s.max << "}";
+	}
+
+	out << "\n\t}\n}\n";
+
+	LogManager::getSingleton().logMessage("Benchmark: " + StringConverter::toString(1000.0f / mean)
+			+ " fps, report written to " + mReportFile);
+}
+
+} /* namespace HMD */
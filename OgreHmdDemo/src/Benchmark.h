@@ -0,0 +1,60 @@
+#ifndef __Benchmark_h_
+#define __Benchmark_h_
+
+#include <OgreRoot.h>
+#include <OgreSceneNode.h>
+#include <vector>
+
+namespace HMD {
+
+using namespace Ogre;
+
+/*
+ * Scripted, non-interactive run of the demo: drives the body node and the head
+ * pose along a camera path with a fixed time step, renders a fixed number of
+ * frames into an offscreen target and writes frame time statistics as JSON.
+ */
+class Benchmark {
+public:
+	struct Keyframe {
+		Real time;
+		Vector3 position;
+		Degree bodyYaw;
+		Degree headYaw;
+		Degree headPitch;
+		Degree headRoll;
+	};
+
+	Benchmark();
+
+	void setFrameCount(size_t frames) { mFrameCount = frames; }
+	size_t getFrameCount() const { return mFrameCount; }
+	size_t getWarmupFrameCount() const { return mWarmupFrames; }
+	void setReportFile(const String &fileName) { mReportFile = fileName; }
+	// Loads keyframes "time x y z bodyYaw headYaw headPitch headRoll", one per line
+	void loadPath(const String &fileName);
+
+	unsigned int getWidth() const { return mWidth; }
+	unsigned int getHeight() const { return mHeight; }
+	Real getTimeStep() const { return mTimeStep; }
+
+	// Moves body and head to the pose of the given frame
+	void applyFrame(size_t frame, SceneNode *bodyNode, Quaternion *headRotation);
+	static void applyKeyframe(const Keyframe &keyframe, SceneNode *bodyNode, Quaternion *headRotation);
+	static Keyframe createKeyframe(Real time, const Vector3 &position, Real bodyYaw, Real headYaw, Real headPitch, Real headRoll);
+	void addFrameTime(unsigned long microseconds);
+	void writeReport(const String &renderSystem);
+
+private:
+	std::vector<Keyframe> mPath;
+	std::vector<unsigned long> mFrameTimes;
+	size_t mFrameCount;
+	size_t mWarmupFrames;
+	unsigned int mWidth;
+	unsigned int mHeight;
+	Real mTimeStep;
+	String mReportFile;
+};
+
+} /* namespace HMD */
+#endif // #ifndef __Benchmark_h_
@@ -0,0 +1,178 @@
+#include "FramePacer.h"
+#include "Profiler.h"
+#include <boost/thread.hpp>
+
+#ifdef HMD_GL_TIMER_QUERY
+#	if OGRE_PLATFORM == OGRE_PLATFORM_APPLE
+#		include <OpenGL/gl3.h>
+#	else
+#		define GL_GLEXT_PROTOTYPES
+#		include <GL/gl.h>
+#		include <GL/glext.h>
+#	endif
+#endif
+
+#define STATS_INTERVAL 120
+#define DEFAULT_SAFETY_MARGIN 2000
+
+namespace HMD {
+
+FramePacer::FramePacer(unsigned int maxFramesAhead, Real refreshRate) :
+		mMaxFramesAhead(std::max(maxFramesAhead, 1u)), mNextFence(0),
+		mFramePeriod((unsigned long) (1000000 / refreshRate)),
+		mSafetyMargin(DEFAULT_SAFETY_MARGIN), mPoseTime(0), mLastPresentTime(0),
+		mSubmitCost(0), mAvgPoseToPresent(0), mMaxPoseToPresent(0), mFrameCount(0),
+		mGpuTimestamps(false), mGpuClockOffset(0) {
+#ifdef HMD_GL_TIMER_QUERY
+	mGpuTimestamps = Root::getSingleton().getRenderSystem()->getName() == "OpenGL Rendering Subsystem";
+#endif
+	calibrateGpuClock();
+	createFences();
+}
+
+FramePacer::~FramePacer() {
+	destroyFences();
+}
+
+void FramePacer::setMaxFramesAhead(unsigned int maxFramesAhead) {
+	destroyFences();
+	mMaxFramesAhead = std::max(maxFramesAhead, 1u);
+	createFences();
+}
+
+void FramePacer::createFences() {
+	RenderSystem *rs = Root::getSingleton().getRenderSystem();
+
+	mFences.resize(mMaxFramesAhead);
+	mNextFence = 0;
+
+	for (size_t i = 0; i < mFences.size(); i++) {
+		mFences[i].query = rs->createHardwareOcclusionQuery();
+		mFences[i].timestamp = 0;
+		mFences[i].poseTime = 0;
+		mFences[i].pending = false;
+#ifdef HMD_GL_TIMER_QUERY
+		if (mGpuTimestamps)
+			glGenQueries(1, &mFences[i].timestamp);
+#endif
+	}
+}
+
+void FramePacer::destroyFences() {
+	RenderSystem *rs = Root::getSingleton().getRenderSystem();
+
+	for (size_t i = 0; i < mFences.size(); i++) {
+		rs->destroyHardwareOcclusionQuery(mFences[i].query);
+#ifdef HMD_GL_TIMER_QUERY
+		if (mFences[i].timestamp)
+			glDeleteQueries(1, &mFences[i].timestamp);
+#endif
+	}
+
+	mFences.clear();
+}
+
+void FramePacer::throttle() {
+	// The fence about to be reused belongs to the frame mMaxFramesAhead frames ago
+	Fence &fence = mFences[mNextFence];
+
+	if (fence.pending)
+		completeFence(fence);
+}
+
+void FramePacer::waitForPoseDeadline() {
+	if (mLastPresentTime == 0)
+		return;
+
+	// Predict the next vertical blank from the last completed frame and leave
+	// enough time to submit the frame after sampling the pose
+	unsigned long now = mTimer.getMicroseconds();
+	unsigned long nextPresent = mLastPresentTime + mFramePeriod;
+
+	while (nextPresent <= now)
+		nextPresent += mFramePeriod;
+
+	unsigned long reserve = mSubmitCost + mSafetyMargin;
+
+	if (nextPresent > now + reserve)
+		boost::this_thread::sleep(boost::posix_time::microseconds(nextPresent - reserve - now));
+}
+
+void FramePacer::poseSampled() {
+	mPoseTime = mTimer.getMicroseconds();
+}
+
+void FramePacer::frameSubmitted() {
+	Fence &fence = mFences[mNextFence];
+	unsigned long now = mTimer.getMicroseconds();
+
+	// Exponential moving average of the CPU time from pose sampling to swap
+	mSubmitCost = (mSubmitCost * 7 + (now - mPoseTime)) / 8;
+
+	fence.query->beginOcclusionQuery();
+	fence.query->endOcclusionQuery();
+#ifdef HMD_GL_TIMER_QUERY
+	// the GPU writes the time once it has processed the swap
+	if (fence.timestamp)
+		glQueryCounter(fence.timestamp, GL_TIMESTAMP);
+#endif
+	fence.poseTime = mPoseTime;
+	fence.pending = true;
+
+	mNextFence = (mNextFence + 1) % mFences.size();
+}
+
+void FramePacer::completeFence(Fence &fence) {
+	unsigned int fragments;
+
+	fence.query->pullOcclusionQuery(&fragments);
+	fence.pending = false;
+
+	unsigned long present = presentTime(fence);
+	// a timestamp before the pose was sampled is a clock mismatch, not a frame
+	unsigned long poseToPresent = present > fence.poseTime ? present - fence.poseTime : 0;
+
+	mLastPresentTime = present;
+	mAvgPoseToPresent = mAvgPoseToPresent * 0.95f + poseToPresent * 0.05f;
+	mMaxPoseToPresent = std::max(mMaxPoseToPresent, poseToPresent);
+	Profiler::getSingleton().setCounter("poseToPresentAvgMs", getAveragePoseToPresent());
+
+	if (++mFrameCount % STATS_INTERVAL == 0) {
+		LogManager::getSingleton().logMessage("Pose to present: avg "
+				+ StringConverter::toString(getAveragePoseToPresent()) + " ms, max "
+				+ StringConverter::toString(getMaxPoseToPresent()) + " ms, "
+				+ StringConverter::toString(mMaxFramesAhead) + " frame(s) ahead");
+		mMaxPoseToPresent = 0;
+		// the GPU and CPU clocks drift apart
+		calibrateGpuClock();
+	}
+}
+
+unsigned long FramePacer::presentTime(Fence &fence) {
+#ifdef HMD_GL_TIMER_QUERY
+	if (fence.timestamp) {
+		// available, the occlusion query issued before it has completed
+		GLuint64 gpuTime = 0;
+		glGetQueryObjectui64v(fence.timestamp, GL_QUERY_RESULT, &gpuTime);
+		long long present = (long long) (gpuTime / 1000) + mGpuClockOffset;
+
+		return present > 0 ? (unsigned long) present : 0;
+	}
+#endif
+	// Without timestamps the best known sync point is the completion of the
+	// fence; a fence that finished before the poll reads late by up to a frame
+	return mTimer.getMicroseconds();
+}
+
+void FramePacer::calibrateGpuClock() {
+#ifdef HMD_GL_TIMER_QUERY
+	if (!mGpuTimestamps)
+		return;
+
+	GLint64 gpuNow = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+	mGpuClockOffset = (long long) mTimer.getMicroseconds() - gpuNow / 1000;
+#endif
+}
+
+} /* namespace HMD */
@@ -0,0 +1,79 @@
+#ifndef __FramePacer_h_
+#define __FramePacer_h_
+
+#include <OgreRoot.h>
+#include <OgreTimer.h>
+#include <OgreHardwareOcclusionQuery.h>
+#include <vector>
+
+namespace HMD {
+
+using namespace Ogre;
+
+/*
+ * Limits how many frames the CPU may run ahead of the GPU and delays the head
+ * pose sampling until the last moment before a frame has to be submitted.
+ *
+ * An empty occlusion query issued after each swap serves as GPU fence: it
+ * completes when the GPU has processed everything submitted before it. With
+ * GL a timestamp query next to it records when the GPU got there, which is
+ * taken as the present time of the frame; other render systems use the time
+ * the fence was found complete.
+ */
+class FramePacer {
+public:
+	FramePacer(unsigned int maxFramesAhead, Real refreshRate);
+	~FramePacer();
+
+	// Blocks until at most mMaxFramesAhead frames are queued on the GPU
+	void throttle(void);
+	// Sleeps until the predicted latest point in time to sample the pose
+	void waitForPoseDeadline(void);
+	// Has to be called right after the head pose has been applied
+	void poseSampled(void);
+	// Has to be called right after the frame has been swapped
+	void frameSubmitted(void);
+
+	void setMaxFramesAhead(unsigned int maxFramesAhead);
+	unsigned int getMaxFramesAhead() const { return mMaxFramesAhead; }
+	void setSafetyMargin(Real milliseconds) { mSafetyMargin = milliseconds * 1000; }
+	// Average and maximum time from pose sampling until the frame was completed on the GPU in ms
+	Real getAveragePoseToPresent() const { return mAvgPoseToPresent / 1000.0f; }
+	Real getMaxPoseToPresent() const { return mMaxPoseToPresent / 1000.0f; }
+
+private:
+	struct Fence {
+		HardwareOcclusionQuery *query;
+		// GL timestamp query, 0 without
+		unsigned int timestamp;
+		unsigned long poseTime;
+		bool pending;
+	};
+
+	std::vector<Fence> mFences;
+	unsigned int mMaxFramesAhead;
+	unsigned int mNextFence;
+	unsigned long mFramePeriod;
+	unsigned long mSafetyMargin;
+	unsigned long mPoseTime;
+	unsigned long mLastPresentTime;
+	unsigned long mSubmitCost;
+	Real mAvgPoseToPresent;
+	unsigned long mMaxPoseToPresent;
+	unsigned long mFrameCount;
+	Timer mTimer;
+	bool mGpuTimestamps;
+	// mTimer microseconds minus GL timestamp microseconds
+	long long mGpuClockOffset;
+
+	void createFences(void);
+	void destroyFences(void);
+	// Waits for the fence and records the present time of its frame
+	void completeFence(Fence &fence);
+	// Present time of a completed fence in mTimer microseconds
+	unsigned long presentTime(Fence &fence);
+	void calibrateGpuClock(void);
+};
+
+} /* namespace HMD */
+#endif // #ifndef __FramePacer_h_
@@ -0,0 +1,417 @@
+#include "FrameRecorder.h"
+#include "Profiler.h"
+#include <OgreRenderWindow.h>
+#include <cstring>
+#include <ctime>
+
+#ifdef HMD_GL_READBACK
+#	if OGRE_PLATFORM == OGRE_PLATFORM_APPLE
+#		include <OpenGL/gl.h>
+#	else
+#		define GL_GLEXT_PROTOTYPES
+#		include <GL/gl.h>
+#		include <GL/glext.h>
+#	endif
+#endif
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+#	include <direct.h>
+#	define popen _popen
+#	define pclose _pclose
+#else
+#	include <sys/stat.h>
+#endif
+
+// Frames between reading into a buffer and mapping it
+#define READBACK_FRAMES 3
+// Frames the encoder may lag behind before frames get dropped
+#define QUEUE_FRAMES 8
+
+namespace HMD {
+
+static bool isVideo(const String &output) {
+	String lower = output;
+	StringUtil::toLowerCase(lower);
+	return StringUtil::endsWith(lower, ".mp4") || StringUtil::endsWith(lower, ".mkv")
+			|| StringUtil::endsWith(lower, ".avi");
+}
+
+FrameRecorder::FrameRecorder(RenderTarget *target, Real frameRate) :
+		mTarget(target), mFrameRate(frameRate), mRecording(false), mEndRecording(false),
+		mScreenshot(false), mGLReadback(false), mWidth(0), mHeight(0),
+		mNextReadback(0), mStopWorker(false), mVideo(0), mFrameIndex(0), mScreenshotIndex(0),
+		mRecorded(0), mDropped(0) {
+#ifdef HMD_GL_READBACK
+	// pixel buffers need the GL context of the window
+	mGLReadback = Root::getSingleton().getRenderSystem()->getName() == "OpenGL Rendering Subsystem"
+			&& dynamic_cast<RenderWindow*>(target) != 0;
+#endif
+}
+
+FrameRecorder::~FrameRecorder() {
+	if (mRecording)
+		stop();
+
+	release();
+}
+
+void FrameRecorder::allocate() {
+	size_t width = mTarget->getWidth(), height = mTarget->getHeight();
+
+	// a running recording keeps its buffers, frameRendered stops it on a resize
+	if (!mFrames.empty() && (mRecording || (width == mWidth && height == mHeight)))
+		return;
+
+	release();
+	mWidth = width;
+	mHeight = height;
+	createBuffers();
+	mWorker = boost::thread(&FrameRecorder::encoderLoop, this);
+}
+
+void FrameRecorder::release() {
+	if (mFrames.empty())
+		return;
+
+	// the frames still read back and the end of a recording go out first
+	flushReadbacks();
+
+	if (mEndRecording) {
+		submitFrame(0);
+		mEndRecording = false;
+	}
+
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		mQueue.push_back(0);
+		mStopWorker = true;
+	}
+
+	mCondition.notify_one();
+	mWorker.join();
+	mStopWorker = false;
+	mVideo = 0;
+	destroyBuffers();
+}
+
+void FrameRecorder::createBuffers() {
+	for (size_t i = 0; i < QUEUE_FRAMES; i++) {
+		Frame *frame = new Frame();
+		frame->pixels.resize(mWidth * mHeight * 4);
+		frame->width = mWidth;
+		frame->height = mHeight;
+		frame->bottomUp = mGLReadback;
+		mFrames.push_back(frame);
+		mFreeFrames.push_back(frame);
+	}
+
+#ifdef HMD_GL_READBACK
+	if (mGLReadback) {
+		mReadbacks.resize(READBACK_FRAMES);
+
+		for (size_t i = 0; i < mReadbacks.size(); i++) {
+			glGenBuffers(1, &mReadbacks[i].buffer);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, mReadbacks[i].buffer);
+			glBufferData(GL_PIXEL_PACK_BUFFER, mWidth * mHeight * 4, 0, GL_STREAM_READ);
+			mReadbacks[i].pending = false;
+		}
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+#endif
+}
+
+void FrameRecorder::destroyBuffers() {
+#ifdef HMD_GL_READBACK
+	for (size_t i = 0; i < mReadbacks.size(); i++)
+		glDeleteBuffers(1, &mReadbacks[i].buffer);
+#endif
+	mReadbacks.clear();
+
+	for (size_t i = 0; i < mFrames.size(); i++)
+		delete mFrames[i];
+
+	mFrames.clear();
+	mFreeFrames.clear();
+}
+
+void FrameRecorder::start(const String &output) {
+	if (mRecording)
+		stop();
+
+	// the previous recording has to end before this one starts, even if its
+	// last frames are still being read back: wait for them
+	if (mEndRecording) {
+		flushReadbacks();
+		submitFrame(0);
+		mEndRecording = false;
+	}
+
+	allocate();
+	mOutput = output;
+
+	if (!isVideo(output)) {
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+		_mkdir(output.c_str());
+#else
+		mkdir(output.c_str(), 0755);
+#endif
+	}
+
+	mRecording = true;
+	mEndRecording = false;
+	mRecorded = mDropped = 0;
+	LogManager::getSingleton().logMessage("Recording to " + output + (mGLReadback ? " (asynchronous readback)" : ""));
+}
+
+void FrameRecorder::stop() {
+	mRecording = false;
+	mEndRecording = true;
+	LogManager::getSingleton().logMessage("Recording stopped: " + StringConverter::toString(mRecorded)
+			+ " frames, " + StringConverter::toString(mDropped) + " dropped");
+}
+
+void FrameRecorder::captureScreenshot() {
+	allocate();
+	mScreenshot = true;
+}
+
+bool FrameRecorder::hasPendingReadbacks() const {
+	for (size_t i = 0; i < mReadbacks.size(); i++) {
+		if (mReadbacks[i].pending)
+			return true;
+	}
+
+	return false;
+}
+
+void FrameRecorder::frameRendered() {
+	// a screenshot read into a pixel buffer is only written once the ring comes round to it
+	if (!mRecording && !mScreenshot && !mEndRecording && !hasPendingReadbacks())
+		return;
+
+	HMD_PROFILE("capture");
+
+	if (mTarget->getWidth() != mWidth || mTarget->getHeight() != mHeight) {
+		// the buffers are sized for the window the recording started with
+		if (mRecording) {
+			LogManager::getSingleton().logMessage("Recording stopped, the window was resized", LML_CRITICAL);
+			stop();
+		}
+
+		mScreenshot = false;
+	}
+
+	bool capture = mRecording || mScreenshot;
+
+#ifdef HMD_GL_READBACK
+	if (mGLReadback) {
+		Readback &readback = mReadbacks[mNextReadback];
+
+		// the oldest buffer was filled READBACK_FRAMES frames ago, mapping it does not wait
+		if (readback.pending)
+			collectReadback(readback);
+
+		if (capture) {
+			GLint alignment;
+			glGetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+			glReadBuffer(GL_BACK);
+			glReadPixels(0, 0, mWidth, mHeight, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			glPixelStorei(GL_PACK_ALIGNMENT, alignment);
+
+			readback.pending = true;
+			readback.record = mRecording;
+			readback.screenshot = mScreenshot;
+		}
+
+		mNextReadback = (mNextReadback + 1) % mReadbacks.size();
+	} else
+#endif
+	if (capture) {
+		Frame *frame = acquireFrame();
+
+		if (frame) {
+			PixelBox box(mWidth, mHeight, 1, PF_BYTE_RGBA, &frame->pixels[0]);
+			mTarget->copyContentsToMemory(box);
+			frame->record = mRecording;
+			frame->screenshot = mScreenshot;
+			frame->output = mOutput;
+			submitFrame(frame);
+		}
+	}
+
+	mScreenshot = false;
+
+	if (mEndRecording && !hasPendingReadbacks()) {
+		submitFrame(0);
+		mEndRecording = false;
+	}
+
+	Profiler &profiler = Profiler::getSingleton();
+	profiler.setCounter("recordedFrames", mRecorded);
+	profiler.setCounter("recordDroppedFrames", mDropped);
+}
+
+void FrameRecorder::collectReadback(Readback &readback) {
+#ifdef HMD_GL_READBACK
+	Frame *frame = acquireFrame();
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+
+	if (frame) {
+		const uchar *data = (const uchar*) glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+
+		if (data) {
+			memcpy(&frame->pixels[0], data, frame->pixels.size());
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+
+		frame->record = readback.record;
+		frame->screenshot = readback.screenshot;
+		frame->output = mOutput;
+		submitFrame(frame);
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+#endif
+	readback.pending = false;
+}
+
+void FrameRecorder::flushReadbacks() {
+	// oldest first, mapping the newer ones waits for the GPU
+	for (size_t i = 0; i < mReadbacks.size(); i++) {
+		Readback &readback = mReadbacks[(mNextReadback + i) % mReadbacks.size()];
+
+		if (readback.pending)
+			collectReadback(readback);
+	}
+}
+
+FrameRecorder::Frame* FrameRecorder::acquireFrame() {
+	boost::mutex::scoped_lock lock(mMutex);
+
+	if (mFreeFrames.empty()) {
+		mDropped++;
+		return 0;
+	}
+
+	Frame *frame = mFreeFrames.back();
+	mFreeFrames.pop_back();
+	return frame;
+}
+
+void FrameRecorder::submitFrame(Frame *frame) {
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		mQueue.push_back(frame);
+
+		if (frame && frame->record)
+			mRecorded++;
+	}
+
+	mCondition.notify_one();
+}
+
+void FrameRecorder::encoderLoop() {
+	while (true) {
+		Frame *frame;
+
+		{
+			boost::mutex::scoped_lock lock(mMutex);
+
+			while (mQueue.empty())
+				mCondition.wait(lock);
+
+			frame = mQueue.front();
+			mQueue.pop_front();
+
+			if (!frame && mStopWorker && mQueue.empty())
+				break;
+		}
+
+		if (frame) {
+			writeFrame(frame);
+
+			boost::mutex::scoped_lock lock(mMutex);
+			mFreeFrames.push_back(frame);
+		} else if (mVideo) {
+			pclose(mVideo);
+			mVideo = 0;
+		}
+
+		if (!frame)
+			mFrameIndex = 0;
+	}
+
+	if (mVideo)
+		pclose(mVideo);
+}
+
+void FrameRecorder::writeFrame(Frame *frame) {
+	const String &output = frame->output;
+
+	if (frame->screenshot) {
+		// the index tells apart screenshots taken within the same second
+		char fileName[64];
+		sprintf(fileName, "screenshot_%lu_%03lu.ppm", (unsigned long) time(0), (unsigned long) mScreenshotIndex++);
+		FILE *file = fopen(fileName, "wb");
+
+		if (file) {
+			writePixels(file, frame);
+			fclose(file);
+		}
+	}
+
+	if (!frame->record)
+		return;
+
+	if (isVideo(output)) {
+		if (!mVideo && mFrameIndex == 0) {
+			// raw RGB frames on stdin, ffmpeg picks the codec from the extension
+			String command = "ffmpeg -loglevel error -y -f rawvideo -pix_fmt rgb24 -s "
+					+ StringConverter::toString(frame->width) + "x" + StringConverter::toString(frame->height)
+					+ " -r " + StringConverter::toString(mFrameRate) + " -i - -pix_fmt yuv420p \"" + output + "\"";
+			mVideo = popen(command.c_str(), "w");
+		}
+
+		if (mVideo)
+			writePixels(mVideo, frame);
+	} else {
+		char name[32];
+		sprintf(name, "/frame_%06lu.ppm", (unsigned long) mFrameIndex);
+		FILE *file = fopen((output + name).c_str(), "wb");
+
+		if (file) {
+			writePixels(file, frame);
+			fclose(file);
+		}
+	}
+
+	mFrameIndex++;
+}
+
+void FrameRecorder::writePixels(FILE *file, const Frame *frame) {
+	// ffmpeg takes the pixels without the header
+	if (file != mVideo)
+		fprintf(file, "P6\n%lu %lu\n255\n", (unsigned long) frame->width, (unsigned long) frame->height);
+
+	mRow.resize(frame->width * 3);
+
+	for (size_t y = 0; y < frame->height; y++) {
+		size_t row = frame->bottomUp ? frame->height - 1 - y : y;
+		const uchar *src = &frame->pixels[row * frame->width * 4];
+
+		for (size_t x = 0; x < frame->width; x++) {
+			mRow[x * 3] = src[x * 4];
+			mRow[x * 3 + 1] = src[x * 4 + 1];
+			mRow[x * 3 + 2] = src[x * 4 + 2];
+		}
+
+		fwrite(&mRow[0], 1, mRow.size(), file);
+	}
+}
+
+} /* namespace HMD */
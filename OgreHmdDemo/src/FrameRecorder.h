@@ -0,0 +1,114 @@
+#ifndef __FrameRecorder_h_
+#define __FrameRecorder_h_
+
+#include <OgreRoot.h>
+#include <OgreRenderTarget.h>
+#include <boost/thread.hpp>
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+namespace HMD {
+
+using namespace Ogre;
+
+/*
+ * Records the distorted stereo frames without stalling the render thread.
+ * With GL (HMD_GL_READBACK) each frame is read into one of a ring of pixel
+ * buffer objects and only mapped a few frames later, when the GPU is done
+ * with it; other render systems fall back to a synchronous copy. Encoding
+ * happens on a worker thread fed through a bounded queue of preallocated
+ * frames: if the encoder falls behind, frames are dropped instead of
+ * delaying the next frame. Buffers and thread only exist from the first
+ * recording or screenshot on. Output is a PPM image sequence in a directory, or
+ * a video if the name ends in .mp4/.mkv/.avi (raw frames piped to ffmpeg).
+ */
+class FrameRecorder {
+public:
+	FrameRecorder(RenderTarget *target, Real frameRate);
+	~FrameRecorder();
+
+	void start(const String &output);
+	void stop(void);
+	bool isRecording() const { return mRecording; }
+	// Writes the next frame to screenshot_<time>_<index>.ppm
+	void captureScreenshot(void);
+
+	// Call once the frame is rendered and before the buffers are swapped
+	void frameRendered(void);
+
+	size_t getRecordedFrames() const { return mRecorded; }
+	size_t getDroppedFrames() const { return mDropped; }
+
+private:
+	struct Frame {
+		std::vector<uchar> pixels; // RGBA
+		size_t width;
+		size_t height;
+		bool bottomUp;
+		bool record;
+		bool screenshot;
+		// Output of the recording the frame belongs to
+		String output;
+	};
+
+	struct Readback {
+		unsigned int buffer;
+		bool pending;
+		bool record;
+		bool screenshot;
+	};
+
+	RenderTarget *mTarget;
+	Real mFrameRate;
+	bool mRecording;
+	// The recording stopped, the end of it is passed on once the readbacks are done
+	bool mEndRecording;
+	bool mScreenshot;
+	bool mGLReadback;
+	size_t mWidth;
+	size_t mHeight;
+	std::vector<Readback> mReadbacks;
+	size_t mNextReadback;
+
+	// Encoder thread and the frames passed to it
+	boost::thread mWorker;
+	boost::mutex mMutex;
+	boost::condition_variable mCondition;
+	std::vector<Frame*> mFrames;
+	std::vector<Frame*> mFreeFrames;
+	std::deque<Frame*> mQueue;
+	bool mStopWorker;
+
+	// Output of the current recording, passed on with every frame. The
+	// encoder thread opens it with the first frame of a recording
+	String mOutput;
+	FILE *mVideo;
+	size_t mFrameIndex;
+	size_t mScreenshotIndex;
+	std::vector<uchar> mRow;
+
+	size_t mRecorded;
+	size_t mDropped;
+
+	// Creates the buffers for the current target size and starts the encoder
+	void allocate(void);
+	// Finishes the queued frames, stops the encoder and frees the buffers
+	void release(void);
+	void createBuffers(void);
+	void destroyBuffers(void);
+	bool hasPendingReadbacks(void) const;
+	// Maps a filled pixel buffer and passes the frame to the encoder
+	void collectReadback(Readback &readback);
+	// Collects all pending readbacks, waiting for the GPU if necessary
+	void flushReadbacks(void);
+	Frame* acquireFrame(void);
+	// A null frame ends the recording
+	void submitFrame(Frame *frame);
+	void encoderLoop(void);
+	void writeFrame(Frame *frame);
+	void writePixels(FILE *file, const Frame *frame);
+};
+
+} /* namespace HMD */
+#endif // #ifndef __FrameRecorder_h_
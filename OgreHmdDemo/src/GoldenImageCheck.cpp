@@ -0,0 +1,158 @@
+#include "GoldenImageCheck.h"
+#include <OgreDataStream.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#define PIXEL_TOLERANCE 0.06f
+#define FAIL_FRACTION 0.005f
+
+namespace HMD {
+
+GoldenImageCheck::GoldenImageCheck(const String &directory, bool record) :
+		mDirectory(directory), mRecord(record), mWidth(640), mHeight(400),
+		mPixelTolerance(PIXEL_TOLERANCE), mFailFraction(FAIL_FRACTION), mFailures(0) {
+	// Poses covering the lens centre, the edges of the warp and a rolled head
+	mPoses.push_back(Benchmark::createKeyframe(0, Vector3(0, 50, 200), 0, 0, 0, 0));
+	mPoses.push_back(Benchmark::createKeyframe(0, Vector3(0, 50, 200), 0, 35, 0, 0));
+	mPoses.push_back(Benchmark::createKeyframe(0, Vector3(0, 50, 200), 0, 0, -30, 0));
+	mPoses.push_back(Benchmark::createKeyframe(0, Vector3(600, 80, -400), -90, 0, -10, 20));
+}
+
+String GoldenImageCheck::getFileName(size_t pose, const String &suffix) const {
+	return mDirectory + "/pose" + StringConverter::toString(pose) + suffix + ".png";
+}
+
+bool GoldenImageCheck::hasGoldenImages() const {
+	for (size_t pose = 0; pose < mPoses.size(); pose++) {
+		if (!std::ifstream(getFileName(pose, "").c_str()))
+			return false;
+	}
+
+	return true;
+}
+
+void GoldenImageCheck::processFrame(size_t pose, RenderTarget *target) {
+	PixelFormat format = PF_BYTE_RGB;
+	uchar *data = OGRE_ALLOC_T(uchar, PixelUtil::getMemorySize(mWidth, mHeight, 1, format), MEMCATEGORY_GENERAL);
+	PixelBox box(mWidth, mHeight, 1, format, data);
+	Image frame;
+
+	target->copyContentsToMemory(box);
+	frame.loadDynamicImage(data, mWidth, mHeight, 1, format, true);
+
+	if (mRecord) {
+		frame.save(getFileName(pose, ""));
+		LogManager::getSingleton().logMessage("Golden image recorded: " + getFileName(pose, ""));
+		return;
+	}
+
+	Image golden, diff;
+	loadImage(getFileName(pose, ""), golden);
+
+	Real differing = compare(golden, frame, diff);
+	String result = "Golden image check, pose " + StringConverter::toString(pose) + ": "
+			+ StringConverter::toString(differing * 100) + "% of the pixels differ";
+
+	if (differing > mFailFraction) {
+		// keep the frame and the differences to see what broke
+		mFailures++;
+		frame.save(getFileName(pose, "_actual"));
+		diff.save(getFileName(pose, "_diff"));
+		LogManager::getSingleton().logMessage(result + " - FAILED, see " + getFileName(pose, "_diff"), LML_CRITICAL);
+	} else {
+		LogManager::getSingleton().logMessage(result + " - ok");
+	}
+}
+
+void GoldenImageCheck::frameFailed(size_t pose) {
+	mFailures++;
+	LogManager::getSingleton().logMessage("Golden image check, pose " + StringConverter::toString(pose)
+			+ ": frame not rendered - FAILED", LML_CRITICAL);
+}
+
+void GoldenImageCheck::loadImage(const String &fileName, Image &image) const {
+	std::ifstream *in = OGRE_NEW_T(std::ifstream, MEMCATEGORY_GENERAL)(fileName.c_str(), std::ios::binary);
+
+	if (!*in) {
+		OGRE_DELETE_T(in, basic_ifstream, MEMCATEGORY_GENERAL);
+		OGRE_EXCEPT(Exception::ERR_FILE_NOT_FOUND, "Golden image " + fileName
+				+ " is missing, record it with --golden-record", "GoldenImageCheck::loadImage");
+	}
+
+	DataStreamPtr stream(OGRE_NEW FileStreamDataStream(fileName, in, true));
+	image.load(stream, "png");
+}
+
+Real GoldenImageCheck::compare(const Image &golden, const Image &frame, Image &diff) const {
+	if (golden.getWidth() != frame.getWidth() || golden.getHeight() != frame.getHeight())
+		return 1;
+
+	size_t width = frame.getWidth(), height = frame.getHeight();
+	std::vector<Real> a, b;
+	size_t differing = 0;
+
+	// per channel, so that a wrong colour of the same brightness (swapped
+	// channels, a wrong chromatic aberration offset) is caught
+	blurredChannels(golden, a);
+	blurredChannels(frame, b);
+
+	uchar *data = OGRE_ALLOC_T(uchar, width * height * 3, MEMCATEGORY_GENERAL);
+
+	for (size_t i = 0; i < a.size(); i += 3) {
+		bool differs = false;
+
+		for (size_t c = 0; c < 3; c++) {
+			Real d = std::abs(a[i + c] - b[i + c]);
+
+			differs = differs || d > mPixelTolerance;
+			data[i + c] = (uchar) std::min(d * 4 * 255, Real(255));
+		}
+
+		if (differs)
+			differing++;
+	}
+
+	diff.loadDynamicImage(data, width, height, 1, PF_BYTE_RGB, true);
+
+	return Real(differing) / (width * height);
+}
+
+void GoldenImageCheck::blurredChannels(const Image &image, std::vector<Real> &channels) const {
+	int width = image.getWidth(), height = image.getHeight();
+	std::vector<Real> l(width * height * 3);
+
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			ColourValue c = image.getColourAt(x, y, 0);
+			Real *p = &l[(y * width + x) * 3];
+			p[0] = c.r;
+			p[1] = c.g;
+			p[2] = c.b;
+		}
+	}
+
+	// 3x3 box blur: sub-pixel differences of the rasterizer and the
+	// distortion sampling must not count, visible shifts still do
+	channels.resize(l.size());
+
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			Real sum[3] = { 0, 0, 0 };
+			int n = 0;
+
+			for (int dy = std::max(y - 1, 0); dy <= std::min(y + 1, height - 1); dy++) {
+				for (int dx = std::max(x - 1, 0); dx <= std::min(x + 1, width - 1); dx++) {
+					for (int c = 0; c < 3; c++)
+						sum[c] += l[(dy * width + dx) * 3 + c];
+					n++;
+				}
+			}
+
+			for (int c = 0; c < 3; c++)
+				channels[(y * width + x) * 3 + c] = sum[c] / n;
+		}
+	}
+}
+
+} /* namespace HMD */
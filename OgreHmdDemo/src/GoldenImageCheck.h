@@ -0,0 +1,62 @@
+#ifndef __GoldenImageCheck_h_
+#define __GoldenImageCheck_h_
+
+#include <OgreRoot.h>
+#include <OgreImage.h>
+#include "Benchmark.h"
+
+namespace HMD {
+
+using namespace Ogre;
+
+/*
+ * Regression check of the distortion and stereo pipeline: renders a fixed set
+ * of poses offscreen and either records the frames as golden images or
+ * compares them against the recorded ones.
+ * The comparison is perceptual rather than exact so that different software
+ * rasterizers and driver versions do not fail it: both images are blurred,
+ * compared per colour channel and only a noticeable share of differing pixels
+ * fails.
+ */
+class GoldenImageCheck {
+public:
+	GoldenImageCheck(const String &directory, bool record);
+
+	bool isRecording() const { return mRecord; }
+	const String& getDirectory() const { return mDirectory; }
+	unsigned int getWidth() const { return mWidth; }
+	unsigned int getHeight() const { return mHeight; }
+	size_t getPoseCount() const { return mPoses.size(); }
+	const Benchmark::Keyframe& getPose(size_t i) const { return mPoses[i]; }
+
+	// Stores or checks the frame rendered for the given pose
+	void processFrame(size_t pose, RenderTarget *target);
+	// Counts a pose whose frame could not be rendered as failed
+	void frameFailed(size_t pose);
+	// Number of poses whose frame did not match its golden image
+	size_t getFailureCount() const { return mFailures; }
+	// Whether the golden images of all poses exist in the directory
+	bool hasGoldenImages() const;
+
+private:
+	String mDirectory;
+	bool mRecord;
+	unsigned int mWidth;
+	unsigned int mHeight;
+	// A pixel differs if a blurred colour channel is off by more than this
+	Real mPixelTolerance;
+	// A frame fails if more than this share of its pixels differ
+	Real mFailFraction;
+	std::vector<Benchmark::Keyframe> mPoses;
+	size_t mFailures;
+
+	String getFileName(size_t pose, const String &suffix) const;
+	void loadImage(const String &fileName, Image &image) const;
+	// Fraction of differing pixels, writes the differences to diff
+	Real compare(const Image &golden, const Image &frame, Image &diff) const;
+	// R, G and B of every pixel, each blurred on its own
+	void blurredChannels(const Image &image, std::vector<Real> &channels) const;
+};
+
+} /* namespace HMD */
+#endif // #ifndef __GoldenImageCheck_h_
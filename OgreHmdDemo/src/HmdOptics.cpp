@@ -0,0 +1,38 @@
+#include "HmdOptics.h"
+#include <OgreGpuProgramManager.h>
+#include "Profiler.h"
+
+#define SHARED_PARAMS "HmdOptics"
+
+namespace HMD {
+
+HmdOptics::HmdOptics(HmdConfig *hmdCfg) :
+		mHmdCfg(hmdCfg), mChangeCount(0) {
+	mParams = GpuProgramManager::getSingleton().getSharedParameters(SHARED_PARAMS);
+	update();
+}
+
+bool HmdOptics::hasChanged(void) const {
+	return mChangeCount == 0
+			|| mHmdCfg->distortion != mUploaded.distortion
+			|| mHmdCfg->scale != mUploaded.scale
+			|| mHmdCfg->projectionCenterOffset != mUploaded.projectionCenterOffset;
+}
+
+void HmdOptics::update(void) {
+	if (!hasChanged())
+		return;
+
+	float scale[2] = { mHmdCfg->scale.x, mHmdCfg->scale.y };
+
+	// Setting the values bumps the version of the shared parameters
+	mParams->setNamedConstant("HmdWarpParam", mHmdCfg->distortion);
+	mParams->setNamedConstant("Scale", scale, 2);
+	mParams->setNamedConstant("LensCentreOffset", mHmdCfg->projectionCenterOffset / 2.0f);
+
+	mUploaded = *mHmdCfg;
+	mChangeCount++;
+	Profiler::getSingleton().setCounter("hmdOpticsChanges", mChangeCount);
+}
+
+} /* namespace HMD */
@@ -0,0 +1,38 @@
+#ifndef __HmdOptics_h_
+#define __HmdOptics_h_
+
+#include <OgreRoot.h>
+#include <OgreGpuProgramParams.h>
+#include "HmdConfig.h"
+
+namespace HMD {
+
+using namespace Ogre;
+
+/*
+ * Keeps the "HmdOptics" shared GPU parameters, referenced by both eye
+ * distortion materials, in sync with the HmdConfig. The parameters are only
+ * written when the config changed, Ogre then copies them into the eye
+ * programs once per change instead of each eye setting them every frame.
+ */
+class HmdOptics {
+public:
+	HmdOptics(HmdConfig *hmdCfg);
+
+	// Uploads the optics if the config changed since the last upload
+	void update(void);
+	// Number of uploads, increments with every actual change
+	unsigned long getChangeCount() const { return mChangeCount; }
+
+private:
+	HmdConfig *mHmdCfg;
+	// Config values of the last upload
+	HmdConfig mUploaded;
+	GpuSharedParametersPtr mParams;
+	unsigned long mChangeCount;
+
+	bool hasChanged(void) const;
+};
+
+} /* namespace HMD */
+#endif // #ifndef __HmdOptics_h_
@@ -0,0 +1,305 @@
+#include "LazyScriptLoader.h"
+#include <OgreCompositorManager.h>
+#include <OgreMaterialManager.h>
+#include <OgreResourceGroupManager.h>
+#include <OgreScriptCompiler.h>
+#include "Profiler.h"
+
+namespace HMD {
+
+struct Token {
+	String value;
+	size_t start;
+	size_t end;
+};
+
+// Splits a script into words, braces and colons, skips comments and unquotes strings
+static void tokenize(const String &text, std::vector<Token> &tokens) {
+	size_t i = 0, n = text.size();
+
+	while (i < n) {
+		char c = text[i];
+
+		if (isspace((uchar) c)) {
+			i++;
+		} else if (c == '/' && i + 1 < n && text[i + 1] == '/') {
+			while (i < n && text[i] != '\n')
+				i++;
+		} else if (c == '/' && i + 1 < n && text[i + 1] == '*') {
+			size_t end = text.find("*/", i + 2);
+			i = end == String::npos ? n : end + 2;
+		} else {
+			Token token;
+			token.start = i;
+
+			if (c == '{' || c == '}' || c == ':') {
+				i++;
+				token.value = String(1, c);
+			} else if (c == '"') {
+				size_t end = text.find('"', i + 1);
+				i = end == String::npos ? n : end + 1;
+				token.value = text.substr(token.start + 1, i - token.start - 2);
+			} else {
+				while (i < n && !isspace((uchar) text[i]) && text[i] != '{' && text[i] != '}' && text[i] != ':')
+					i++;
+				token.value = text.substr(token.start, i - token.start);
+			}
+
+			token.end = i;
+			tokens.push_back(token);
+		}
+	}
+}
+
+LazyScriptLoader::LazyScriptLoader(const String &sourceGroup, const String &targetGroup) :
+		mTargetGroup(targetGroup), mParsedCount(0) {
+	ResourceGroupManager &rgm = ResourceGroupManager::getSingleton();
+	const char *patterns[] = { "*.program", "*.material", "*.compositor" };
+
+	if (!rgm.resourceGroupExists(sourceGroup))
+		return;
+
+	for (size_t p = 0; p < 3; p++) {
+		StringVectorPtr names = rgm.findResourceNames(sourceGroup, patterns[p]);
+
+		for (size_t i = 0; i < names->size(); i++)
+			indexScript((*names)[i], rgm.openResource((*names)[i], sourceGroup)->getAsString());
+	}
+
+	LogManager::getSingleton().logMessage("LazyScriptLoader: indexed "
+			+ StringConverter::toString(mDefinitions.size()) + " definitions of group " + sourceGroup);
+
+	createPlaceholders();
+	ScriptCompilerManager::getSingleton().setListener(this);
+}
+
+LazyScriptLoader::~LazyScriptLoader() {
+	ScriptCompilerManager::getSingleton().setListener(0);
+}
+
+void LazyScriptLoader::createPlaceholders(void) {
+	MaterialManager &materialMngr = MaterialManager::getSingleton();
+
+	for (std::map<String, Definition>::iterator it = mDefinitions.begin(); it != mDefinitions.end(); ++it) {
+		if (it->second.abstract || !StringUtil::startsWith(it->first, "material ", false))
+			continue;
+
+		String name = it->first.substr(9);
+
+		if (!materialMngr.resourceExists(name)) {
+			materialMngr.create(name, mTargetGroup, true, this);
+			mPlaceholders.insert(name);
+		}
+	}
+}
+
+String LazyScriptLoader::getKey(const String &kind, const String &name) {
+	// All program types share one namespace, as they do in the GpuProgramManager
+	if (StringUtil::endsWith(kind, "_program"))
+		return "program " + name;
+
+	return kind + " " + name;
+}
+
+void LazyScriptLoader::indexScript(const String &fileName, const String &text) {
+	std::vector<Token> tokens;
+	size_t i = 0;
+
+	tokenize(text, tokens);
+
+	while (i < tokens.size()) {
+		if (tokens[i].value == "import") {
+			// imports are resolved by the index itself: import <what> from <file>
+			LogManager::getSingleton().logMessage("LazyScriptLoader: ignoring import in " + fileName);
+			i += 4;
+			continue;
+		}
+
+		size_t open = i;
+
+		while (open < tokens.size() && tokens[open].value != "{" && tokens[open].value != "}")
+			open++;
+
+		if (open == tokens.size() || tokens[open].value == "}" || open == i) {
+			i = open + 1;
+			continue;
+		}
+
+		size_t close = open;
+		int depth = 0;
+
+		for (; close < tokens.size(); close++) {
+			if (tokens[close].value == "{")
+				depth++;
+			else if (tokens[close].value == "}" && --depth == 0)
+				break;
+		}
+
+		if (close == tokens.size())
+			break;
+
+		Definition def;
+		def.abstract = tokens[i].value == "abstract";
+		def.parsed = false;
+
+		size_t kindIndex = def.abstract ? i + 1 : i;
+		String kind = tokens[kindIndex].value;
+		String name = kindIndex + 1 < open ? tokens[kindIndex + 1].value : "";
+		String lastKind = kind;
+
+		def.text = text.substr(tokens[i].start, tokens[close].end - tokens[i].start);
+
+		for (size_t t = kindIndex + 1; t + 1 < close; t++) {
+			const String &value = tokens[t].value;
+			Dependency dep;
+			dep.inherited = false;
+
+			if (value == "technique" || value == "pass" || value == "texture_unit") {
+				lastKind = value;
+			} else if (value == ":") {
+				dep.key = getKey(lastKind, tokens[t + 1].value);
+				dep.inherited = true;
+			} else if (StringUtil::endsWith(value, "_program_ref") || value == "delegate") {
+				dep.key = getKey("program", tokens[t + 1].value);
+			} else if (value == "shared_params_ref") {
+				dep.key = getKey("shared_params", tokens[t + 1].value);
+			} else if (value == "material" || value == "shadow_caster_material"
+					|| value == "shadow_receiver_material") {
+				dep.key = getKey("material", tokens[t + 1].value);
+			} else if (value == "texture_ref" && t + 2 < close) {
+				dep.key = getKey("compositor", tokens[t + 2].value);
+			}
+
+			if (!dep.key.empty())
+				def.dependencies.push_back(dep);
+		}
+
+		String key = getKey(kind, name);
+
+		// like the script compiler the first definition of a name wins
+		if (mDefinitions.find(key) == mDefinitions.end())
+			mDefinitions[key] = def;
+
+		i = close + 1;
+	}
+}
+
+void LazyScriptLoader::ensureMaterial(const String &name) {
+	String key = getKey("material", name);
+
+	// placeholders exist as well, they are parsed by ensure
+	if (mDefinitions.count(key) || !MaterialManager::getSingleton().resourceExists(name))
+		ensure(key);
+}
+
+void LazyScriptLoader::ensureCompositor(const String &name) {
+	if (!CompositorManager::getSingleton().resourceExists(name))
+		ensure(getKey("compositor", name));
+}
+
+void LazyScriptLoader::ensureAll(void) {
+	for (std::map<String, Definition>::iterator it = mDefinitions.begin(); it != mDefinitions.end(); ++it) {
+		if (!it->second.parsed && !it->second.abstract)
+			ensure(it->first);
+	}
+}
+
+void LazyScriptLoader::ensure(const String &key) {
+	if (mDefinitions.find(key) == mDefinitions.end()) {
+		LogManager::getSingleton().logMessage("LazyScriptLoader: no script defines " + key);
+		return;
+	}
+
+	std::set<String> visited;
+	String script;
+
+	collect(key, false, visited, script);
+
+	if (script.empty())
+		return;
+
+	// parsed as one script so that inherited definitions are resolved
+	HMD_PROFILE("scripts/parse");
+	DataStreamPtr stream(OGRE_NEW MemoryDataStream(key, (void*) script.c_str(), script.size(), false, true));
+	ScriptCompilerManager::getSingleton().parseScript(stream, mTargetGroup);
+
+	Profiler::getSingleton().setCounter("scriptDefinitionsParsed", mParsedCount);
+}
+
+void LazyScriptLoader::collect(const String &key, bool inherited, std::set<String> &visited, String &script) {
+	std::map<String, Definition>::iterator it = mDefinitions.find(key);
+
+	if (it == mDefinitions.end() || visited.count(key))
+		return;
+
+	Definition &def = it->second;
+
+	// referenced definitions are global once parsed, parents have to be in the same script
+	if (def.parsed && !inherited)
+		return;
+
+	visited.insert(key);
+
+	for (size_t i = 0; i < def.dependencies.size(); i++)
+		collect(def.dependencies[i].key, def.dependencies[i].inherited, visited, script);
+
+	if (def.parsed) {
+		// already created, repeat it as abstract parent only
+		script += "abstract " + def.text + "\n";
+	} else {
+		script += def.text + "\n";
+
+		if (!def.abstract) {
+			def.parsed = true;
+			mParsedCount++;
+		}
+	}
+}
+
+void LazyScriptLoader::processMaterialName(Mesh *mesh, String *name) {
+	ensureMaterial(*name);
+}
+
+void LazyScriptLoader::processSkeletonName(Mesh *mesh, String *name) {
+}
+
+void LazyScriptLoader::processMeshCompleted(Mesh *mesh) {
+}
+
+void LazyScriptLoader::loadResource(Resource *resource) {
+	Material *material = static_cast<Material*>(resource);
+	Definition &def = mDefinitions[getKey("material", material->getName())];
+
+	if (!def.parsed) {
+		// nobody requested it, worth an ensureMaterial where it is used
+		LogManager::getSingleton().logMessage("LazyScriptLoader: parsing material "
+				+ material->getName() + " on first use");
+		ensure(getKey("material", material->getName()));
+	}
+
+	// what Material::prepareImpl and loadImpl do for a scripted material
+	material->compile();
+	Material::TechniqueIterator techniques = material->getSupportedTechniqueIterator();
+
+	while (techniques.hasMoreElements()) {
+		Technique *technique = techniques.getNext();
+		technique->_prepare();
+		technique->_load();
+	}
+}
+
+bool LazyScriptLoader::handleEvent(ScriptCompiler *compiler, ScriptCompilerEvent *evt, void *retval) {
+	if (evt->mType != CreateMaterialScriptCompilerEvent::eventType)
+		return false;
+
+	const String &name = static_cast<CreateMaterialScriptCompilerEvent*>(evt)->mName;
+
+	if (!mPlaceholders.count(name))
+		return false;
+
+	// the script fills the placeholder, pointers handed out earlier stay valid
+	*static_cast<Material**>(retval) = MaterialManager::getSingleton().getByName(name).get();
+	return true;
+}
+
+} /* namespace HMD */
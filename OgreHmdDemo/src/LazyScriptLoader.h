@@ -0,0 +1,74 @@
+#ifndef __LazyScriptLoader_h_
+#define __LazyScriptLoader_h_
+
+#include <OgreRoot.h>
+#include <OgreMeshSerializer.h>
+#include <OgreScriptCompiler.h>
+#include <set>
+
+namespace HMD {
+
+using namespace Ogre;
+
+/*
+ * Parses material, program and compositor scripts on demand instead of
+ * initialising the whole script group. The scripts of the source group are
+ * indexed once into their top level definitions and the references between
+ * them (parents, program refs, shared params, compositor materials and
+ * texture refs). Requesting a definition parses it together with everything
+ * it depends on into the target group.
+ * Mesh materials are requested automatically when a mesh is loaded. Every
+ * other indexed material exists as an empty manual placeholder, loading it
+ * (e.g. when an entity, sky or compositor uses it) parses its script into
+ * the placeholder. Compositors have to be requested before they are used.
+ */
+class LazyScriptLoader: public MeshSerializerListener,
+		public ManualResourceLoader,
+		public ScriptCompilerListener {
+public:
+	LazyScriptLoader(const String &sourceGroup, const String &targetGroup);
+	virtual ~LazyScriptLoader();
+
+	void ensureMaterial(const String &name);
+	void ensureCompositor(const String &name);
+	// Parses every indexed definition, e.g. to compile all programs
+	void ensureAll(void);
+
+	// MeshSerializerListener: resolves the materials of meshes being loaded
+	void processMaterialName(Mesh *mesh, String *name);
+	void processSkeletonName(Mesh *mesh, String *name);
+	void processMeshCompleted(Mesh *mesh);
+	// ManualResourceLoader: parses a placeholder material on first use
+	void loadResource(Resource *resource);
+	// ScriptCompilerListener: fills placeholders instead of creating materials
+	bool handleEvent(ScriptCompiler *compiler, ScriptCompilerEvent *evt, void *retval);
+
+private:
+	struct Dependency {
+		String key;
+		// Parent the definition inherits from, has to be in the same parse
+		bool inherited;
+	};
+
+	struct Definition {
+		String text;
+		std::vector<Dependency> dependencies;
+		bool abstract;
+		bool parsed;
+	};
+
+	String mTargetGroup;
+	std::map<String, Definition> mDefinitions;
+	size_t mParsedCount;
+	// Names of the placeholder materials
+	std::set<String> mPlaceholders;
+
+	void indexScript(const String &fileName, const String &text);
+	void createPlaceholders(void);
+	void ensure(const String &key);
+	void collect(const String &key, bool inherited, std::set<String> &visited, String &script);
+	static String getKey(const String &kind, const String &name);
+};
+
+} /* namespace HMD */
+#endif // #ifndef __LazyScriptLoader_h_
@@ -0,0 +1,124 @@
+#include "LoadingScene.h"
+
+#define MATERIAL "BaseWhiteNoLighting"
+#define RADIUS 400
+#define SEGMENTS 24
+#define RINGS 12
+#define BAR_WIDTH 120.0f
+#define BAR_HEIGHT 8.0f
+#define BAR_DISTANCE 250.0f
+
+namespace HMD {
+
+LoadingScene::LoadingScene(SceneManager *sceneMgr, SceneNode *bodyNode) :
+		mSceneMgr(sceneMgr), mProgress(-1) {
+	// a sibling of the body node: placed where the body starts, but not moved with it
+	mNode = bodyNode->getParentSceneNode()->createChildSceneNode(bodyNode->_getDerivedPosition());
+
+	mSurroundings = mSceneMgr->createManualObject("LoadingSurroundings");
+	mSurroundings->setCastShadows(false);
+	createSurroundings();
+	mNode->attachObject(mSurroundings);
+
+	mProgressBar = mSceneMgr->createManualObject("LoadingProgress");
+	mProgressBar->setCastShadows(false);
+	mProgressBar->setDynamic(true);
+	setProgress(0);
+	mNode->attachObject(mProgressBar);
+}
+
+LoadingScene::~LoadingScene() {
+	mNode->detachAllObjects();
+	mSceneMgr->destroyManualObject(mSurroundings);
+	mSceneMgr->destroyManualObject(mProgressBar);
+	mSceneMgr->destroySceneNode(mNode);
+}
+
+void LoadingScene::createSurroundings(void) {
+	ColourValue colour(0.2f, 0.3f, 0.4f);
+
+	mSurroundings->begin(MATERIAL, RenderOperation::OT_LINE_LIST);
+
+	// meridians and parallels of a sphere around the head
+	for (int i = 0; i < SEGMENTS; i++) {
+		Radian yaw0(Math::TWO_PI * i / SEGMENTS), yaw1(Math::TWO_PI * (i + 1) / SEGMENTS);
+
+		for (int j = 0; j < RINGS; j++) {
+			Radian pitch0(Math::PI * j / RINGS - Math::HALF_PI), pitch1(Math::PI * (j + 1) / RINGS - Math::HALF_PI);
+			Vector3 a(Math::Cos(pitch0) * Math::Sin(yaw0), Math::Sin(pitch0), Math::Cos(pitch0) * Math::Cos(yaw0));
+			Vector3 b(Math::Cos(pitch0) * Math::Sin(yaw1), Math::Sin(pitch0), Math::Cos(pitch0) * Math::Cos(yaw1));
+			Vector3 c(Math::Cos(pitch1) * Math::Sin(yaw0), Math::Sin(pitch1), Math::Cos(pitch1) * Math::Cos(yaw0));
+
+			mSurroundings->position(a * RADIUS);
+			mSurroundings->colour(colour);
+			mSurroundings->position(b * RADIUS);
+			mSurroundings->colour(colour);
+			mSurroundings->position(a * RADIUS);
+			mSurroundings->colour(colour);
+			mSurroundings->position(c * RADIUS);
+			mSurroundings->colour(colour);
+		}
+	}
+
+	// floor grid at the ground level
+	Real floor = -mNode->getPosition().y;
+
+	for (int i = -10; i <= 10; i++) {
+		Real offset = i * RADIUS / 10.0f;
+
+		mSurroundings->position(offset, floor, -RADIUS);
+		mSurroundings->colour(colour);
+		mSurroundings->position(offset, floor, RADIUS);
+		mSurroundings->colour(colour);
+		mSurroundings->position(-RADIUS, floor, offset);
+		mSurroundings->colour(colour);
+		mSurroundings->position(RADIUS, floor, offset);
+		mSurroundings->colour(colour);
+	}
+
+	mSurroundings->end();
+}
+
+void LoadingScene::setProgress(Real progress) {
+	// rebuilding the bar is cheap, but only needed once the bar grew visibly
+	if (Math::Abs(progress - mProgress) < 0.01f && progress < 1)
+		return;
+
+	mProgress = progress;
+	updateProgressBar();
+}
+
+void LoadingScene::updateProgressBar(void) {
+	Real left = -BAR_WIDTH / 2, right = left + BAR_WIDTH * mProgress;
+	Real top = BAR_HEIGHT / 2, bottom = -BAR_HEIGHT / 2;
+
+	if (mProgressBar->getNumSections() == 0)
+		mProgressBar->begin(MATERIAL, RenderOperation::OT_TRIANGLE_LIST);
+	else
+		mProgressBar->beginUpdate(0);
+
+	// frame and filled part, facing the initial view direction (-z)
+	mProgressBar->position(left - 2, bottom - 2, -BAR_DISTANCE);
+	mProgressBar->colour(0.3f, 0.3f, 0.3f);
+	mProgressBar->position(-left + 2, bottom - 2, -BAR_DISTANCE);
+	mProgressBar->colour(0.3f, 0.3f, 0.3f);
+	mProgressBar->position(-left + 2, top + 2, -BAR_DISTANCE);
+	mProgressBar->colour(0.3f, 0.3f, 0.3f);
+	mProgressBar->position(left - 2, top + 2, -BAR_DISTANCE);
+	mProgressBar->colour(0.3f, 0.3f, 0.3f);
+
+	mProgressBar->position(left, bottom, -BAR_DISTANCE + 1);
+	mProgressBar->colour(0.9f, 0.6f, 0.1f);
+	mProgressBar->position(right, bottom, -BAR_DISTANCE + 1);
+	mProgressBar->colour(0.9f, 0.6f, 0.1f);
+	mProgressBar->position(right, top, -BAR_DISTANCE + 1);
+	mProgressBar->colour(0.9f, 0.6f, 0.1f);
+	mProgressBar->position(left, top, -BAR_DISTANCE + 1);
+	mProgressBar->colour(0.9f, 0.6f, 0.1f);
+
+	mProgressBar->quad(0, 1, 2, 3);
+	mProgressBar->quad(4, 5, 6, 7);
+	mProgressBar->end();
+}
+
+} /* namespace HMD */
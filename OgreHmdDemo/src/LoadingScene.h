@@ -0,0 +1,38 @@
+#ifndef __LoadingScene_h_
+#define __LoadingScene_h_
+
+#include <OgreRoot.h>
+#include <OgreSceneManager.h>
+#include <OgreManualObject.h>
+
+namespace HMD {
+
+using namespace Ogre;
+
+/*
+ * Minimal scene shown while the real content streams in: a wireframe sphere
+ * and floor grid around the body and a progress bar ahead. It is fixed in
+ * the world, so it follows head rotation like the real scene would and
+ * uses no textures, lighting or shadows.
+ */
+class LoadingScene {
+public:
+	LoadingScene(SceneManager *sceneMgr, SceneNode *bodyNode);
+	~LoadingScene();
+
+	// Progress in [0, 1]
+	void setProgress(Real progress);
+
+private:
+	SceneManager *mSceneMgr;
+	SceneNode *mNode;
+	ManualObject *mSurroundings;
+	ManualObject *mProgressBar;
+	Real mProgress;
+
+	void createSurroundings(void);
+	void updateProgressBar(void);
+};
+
+} /* namespace HMD */
+#endif // #ifndef __LoadingScene_h_
@@ -0,0 +1,110 @@
+#include "GyroBiasModel.h"
+#include <algorithm>
+#include <math.h>
+
+// Window length and what counts as resting: the L3G4200D noise is about
+// 0.3 dps rms, a head held still shakes by more than 1 dps, so only a
+// headset that was put down teaches the model
+#define STATIONARY_WINDOW 0.5
+#define STATIONARY_MAX_NOISE 0.015
+// Larger means are motion, no residual bias after calibration gets there
+#define STATIONARY_MAX_RATE 0.05
+// Windows a bin averages over, later ones replace the oldest
+#define BIN_MAX_WEIGHT 20
+// Degrees beyond the learned range the line is extrapolated
+#define MAX_EXTRAPOLATION 5
+
+GyroBiasModel::GyroBiasModel() :
+		temperature(0), hasTemperature(false) {
+	reset();
+}
+
+void GyroBiasModel::reset() {
+	bins.clear();
+	bias = Vector3::ZERO;
+	stationaryWindows = 0;
+	sum = Vector3::ZERO;
+	sumSquares = Vector3::ZERO;
+	count = 0;
+	windowTime = 0;
+}
+
+void GyroBiasModel::setTemperature(int _temperature) {
+	bool changed = !hasTemperature || temperature != _temperature;
+
+	temperature = _temperature;
+	hasTemperature = true;
+
+	if (changed)
+		updateBias();
+}
+
+void GyroBiasModel::addSample(const Vector3 &gyro, Real timeDelta) {
+	// without a temperature there is no bin to learn into
+	if (!hasTemperature)
+		return;
+
+	sum += gyro;
+	sumSquares += gyro * gyro;
+	count++;
+	windowTime += timeDelta;
+
+	if (windowTime >= STATIONARY_WINDOW)
+		endWindow();
+}
+
+void GyroBiasModel::endWindow() {
+	Vector3 mean = sum / count;
+	Vector3 variance = sumSquares / count - mean * mean;
+	Real noise = sqrt(std::max(std::max(variance.x, variance.y), std::max(variance.z, Real(0))));
+
+	sum = Vector3::ZERO;
+	sumSquares = Vector3::ZERO;
+	count = 0;
+	windowTime = 0;
+
+	if (noise > STATIONARY_MAX_NOISE || mean.length() > STATIONARY_MAX_RATE)
+		return;
+
+	Bin &bin = bins[temperature];
+	bin.weight = std::min(bin.weight + 1, Real(BIN_MAX_WEIGHT));
+	bin.bias += (mean - bin.bias) / bin.weight;
+	stationaryWindows++;
+
+	updateBias();
+}
+
+void GyroBiasModel::updateBias() {
+	if (bins.empty()) {
+		bias = Vector3::ZERO;
+		return;
+	}
+
+	// weighted least squares bias = a + b * t, per axis
+	Real w = 0, t = 0, tt = 0;
+	Vector3 b = Vector3::ZERO, tb = Vector3::ZERO;
+
+	for (std::map<int, Bin>::const_iterator i = bins.begin(); i != bins.end(); ++i) {
+		w += i->second.weight;
+		t += i->second.weight * i->first;
+		tt += i->second.weight * i->first * i->first;
+		b += i->second.bias * i->second.weight;
+		tb += i->second.bias * (i->second.weight * i->first);
+	}
+
+	Real meanT = t / w;
+	Real varianceT = tt / w - meanT * meanT;
+	Vector3 meanBias = b / w;
+
+	// a single temperature, or nearly: no slope to fit
+	if (bins.size() < 2 || varianceT < 0.25) {
+		bias = meanBias;
+		return;
+	}
+
+	Vector3 slope = (tb / w - meanBias * meanT) / varianceT;
+	int lowest = bins.begin()->first, highest = bins.rbegin()->first;
+	Real at = std::min(std::max(temperature, lowest - MAX_EXTRAPOLATION), highest + MAX_EXTRAPOLATION);
+
+	bias = meanBias + slope * (at - meanT);
+}
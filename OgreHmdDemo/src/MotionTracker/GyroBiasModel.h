@@ -0,0 +1,58 @@
+#ifndef _GYROBIASMODEL_H_
+#define _GYROBIASMODEL_H_
+
+#include <OgreRoot.h>
+
+#include <map>
+using namespace Ogre;
+
+/*
+ * Gyro bias as a function of the die temperature, learned while the tracker
+ * rests. The device subtracts the bias it measured at calibration time, this
+ * model follows what is left of it as the headset warms up.
+ *
+ * Samples are collected in windows; a window with a small mean rate and
+ * little noise counts as stationary and its mean updates the bin of the
+ * current temperature. The bias at a temperature is a least squares line
+ * through the bins, so a temperature seen once still gets a sensible value.
+ */
+class GyroBiasModel {
+	public:
+		GyroBiasModel();
+
+		// Raw L3G4200D OUT_TEMP, -1 per degree C with a part specific offset
+		void setTemperature(int temperature);
+		// Adds one gyro sample (rad/s, without the model bias) to the current
+		// window, before the zero rate threshold: zeroed samples hide the bias
+		void addSample(const Vector3 &gyro, Real timeDelta);
+		// Bias at the current temperature, rad/s
+		const Vector3& getBias() const { return bias; }
+		size_t getStationaryWindows() const { return stationaryWindows; }
+		// Forgets everything, after the device measured a new zero rate
+		void reset();
+
+	private:
+		struct Bin {
+			Vector3 bias;
+			Real weight;
+			Bin() : bias(Vector3::ZERO), weight(0) {}
+		};
+
+		std::map<int, Bin> bins;
+		int temperature;
+		bool hasTemperature;
+		Vector3 bias;
+		size_t stationaryWindows;
+
+		// current window
+		Vector3 sum;
+		Vector3 sumSquares;
+		size_t count;
+		Real windowTime;
+
+		void endWindow();
+		// Least squares line through the bins at the current temperature
+		void updateBias();
+};
+
+#endif
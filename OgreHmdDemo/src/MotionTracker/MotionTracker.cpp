@@ -6,32 +6,103 @@
  */
 
 #include "MotionTracker.h"
+#include "../Profiler.h"
+#include <boost/bind.hpp>
 #include <math.h>
 #include <algorithm>
 
-static void startReading(MotionTracker* _mt) {
-	while (true) {
-		_mt->read();
+// Packet framing and encoding, has to match Gyro.ino:
+//   sync, type, payload length, payload, 8 bit sum of type, length and payload
+#define PACKET_SYNC 0xA5
+#define PACKET_SAMPLES 1
+#define PACKET_CONFIG 2
+#define PACKET_CAPABILITIES 3
+#define PACKET_ACK 4
+#define PACKET_ORIENTATION 5
+#define PACKET_CALIBRATION 6
+#define CALIBRATION_STORED 0
+#define PACKET_HEADER 3
+#define PACKET_HAS_ACCEL 0x01
+#define PACKET_HAS_MAG 0x02
+#define PACKET_HAS_TEMP 0x04
+#define DELTA_ESCAPE -128
+#define SAMPLE_SIZE 6
+#define CMD_QUERY 0x10
+#define CMD_SET_RATE 0x11
+#define CMD_SET_SCALE 0x12
+#define CMD_SET_WATERMARK 0x13
+#define CMD_SET_CHANNELS 0x14
+#define CMD_SET_THRESHOLD 0x15
+#define CMD_SET_HPF 0x16
+#define CMD_SET_MODE 0x17
+#define CMD_CALIBRATE 0x18
+#define ACK_OK 0
+#define REPLY_TIMEOUT 200
+#define COMMAND_ATTEMPTS 3
+#define SERIAL_BAUD 115200
+#define STATS_INTERVAL 1000000
+#define Q30_ONE 1073741824.0
+
+// Little endian int16, false if it would read past end
+static bool readShort(const unsigned char *&p, const unsigned char *end, short &value) {
+	if (end - p < 2)
+		return false;
+	value = (short) (p[0] | (p[1] << 8));
+	p += 2;
+	return true;
+}
+
+// Little endian int32, false if it would read past end
+static bool readInt(const unsigned char *&p, const unsigned char *end, int &value) {
+	if (end - p < 4)
+		return false;
+	value = (int) (p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24));
+	p += 4;
+	return true;
+}
+
+// One int8 delta or DELTA_ESCAPE and an int16 delta, added to value
+static bool readDelta(const unsigned char *&p, const unsigned char *end, short &value) {
+	if (p == end)
+		return false;
+
+	signed char delta = (signed char) *p++;
+
+	if (delta != DELTA_ESCAPE) {
+		value += delta;
+		return true;
 	}
+
+	short wide;
+	if (!readShort(p, end, wide))
+		return false;
+	value += wide;
+	return true;
 }
 
-void MotionTracker::create(Quaternion *_output) {
+static void startReading(MotionTracker* _mt) {
+	_mt->run();
+}
+
+MotionTracker* MotionTracker::create(Quaternion *_output) {
 	MotionTracker* mt = new MotionTracker(_output);
 	boost::thread thread(startReading, mt);
 	thread.detach();
+	return mt;
 }
 
 MotionTracker::MotionTracker(Quaternion *_output) :
 		driftCounter(0), compensationCounter(0.0f), avAcc(Vector3(0.0)), tiltAxis(
-				Vector3(0.0)) {
+				Vector3(0.0)), mag(Vector3::ZERO), scaleRate(0), samplePeriod(0), zeroRateThreshold(0), hostThreshold(false), sampleCount(0),
+				byteCount(0), checksumErrors(0), lastStatsTime(0), ackCommand(-1),
+				ackStatus(0), capabilitiesReceived(false), calibrating(false), deviceMode(MODE_SAMPLES),
+				hasDeviceOrientation(false), angularVelocity(Vector3::ZERO) {
 	output = _output;
 
-	serial_port_base::baud_rate BAUD(38400);
+	serial_port_base::baud_rate BAUD(SERIAL_BAUD);
 	serial_port_base::parity PARITY(serial_port_base::parity::none);
 	serial_port_base::stop_bits STOP(serial_port_base::stop_bits::one);
 
-	io_service io;
-
 	serial = new serial_port(io, "/dev/ttyACM0");
 
 	serial->set_option(BAUD);
@@ -43,31 +114,477 @@ MotionTracker::~MotionTracker() {
 	delete output;
 }
 
-void MotionTracker::read() {
-	int length = 22;
-	char r[length];
+void MotionTracker::run() {
+	// The port is only used by handlers on this thread, which run one at a
+	// time: asio objects must not be used by two threads at once, so other
+	// threads post their writes here instead of writing themselves
+	startRead();
+	io.run();
+}
+
+void MotionTracker::startRead() {
+	serial->async_read_some(buffer(readBuffer, sizeof(readBuffer)),
+			boost::bind(&MotionTracker::handleRead, this, placeholders::error, placeholders::bytes_transferred));
+}
+
+void MotionTracker::handleRead(const boost::system::error_code &error, size_t length) {
+	if (error) {
+		LogManager::getSingleton().logMessage("MotionTracker: reading failed, " + error.message(), LML_CRITICAL);
+		return;
+	}
+
+	// a packet carries all samples queued in the sensor FIFOs, so its length
+	// varies: take whatever arrived and parse the complete packets
+	pending.insert(pending.end(), readBuffer, readBuffer + length);
+	byteCount += length;
+	parsePackets();
+	startRead();
+}
+
+void MotionTracker::queueWrite(const std::vector<unsigned char> &packet) {
+	writeQueue.push_back(packet);
+
+	if (writeQueue.size() == 1)
+		startWrite();
+}
+
+void MotionTracker::startWrite() {
+	async_write(*serial, buffer(writeQueue.front()), boost::bind(&MotionTracker::handleWrite, this, placeholders::error));
+}
+
+void MotionTracker::handleWrite(const boost::system::error_code &error) {
+	if (error)
+		LogManager::getSingleton().logMessage("MotionTracker: writing failed, " + error.message(), LML_CRITICAL);
+
+	writeQueue.pop_front();
+
+	if (!writeQueue.empty())
+		startWrite();
+}
+
+void MotionTracker::parsePackets() {
+	size_t start = 0;
+
+	while (pending.size() - start >= PACKET_HEADER + 1) {
+		if (pending[start] != PACKET_SYNC) {
+			start++;
+			continue;
+		}
+
+		size_t length = pending[start + 2];
+
+		if (pending.size() - start < PACKET_HEADER + length + 1)
+			break;
+
+		unsigned char checksum = 0;
+		for (size_t i = start + 1; i < start + PACKET_HEADER + length; i++)
+			checksum += pending[i];
+
+		if (checksum != pending[start + PACKET_HEADER + length]) {
+			// not a packet or a corrupted one: resync on the next sync byte
+			checksumErrors++;
+			start++;
+			continue;
+		}
+
+		if (pending[start + 1] == PACKET_SAMPLES)
+			assignValues(&pending[start + PACKET_HEADER], length);
+		else if (pending[start + 1] == PACKET_CONFIG)
+			assignConfig(&pending[start + PACKET_HEADER], length);
+		else if (pending[start + 1] == PACKET_ORIENTATION)
+			assignOrientation(&pending[start + PACKET_HEADER], length);
+		else if (pending[start + 1] == PACKET_ACK)
+			assignAck(&pending[start + PACKET_HEADER], length);
+		else if (pending[start + 1] == PACKET_CAPABILITIES)
+			assignCapabilities(&pending[start + PACKET_HEADER], length);
+		else if (pending[start + 1] == PACKET_CALIBRATION)
+			assignCalibration(&pending[start + PACKET_HEADER], length);
 
-	boost::asio::read(*serial, buffer(&r, length), transfer_at_least(length));
-	assignValues(r);
+		start += PACKET_HEADER + length + 1;
+	}
 
+	pending.erase(pending.begin(), pending.begin() + start);
+	updateCounters();
 }
 
-void MotionTracker::assignValues(char *_values) {
-	double scaleRate = convert(_values[18], _values[19]);
-	double timeDelta = convert(_values[20], _values[21]) / pow(10, 6);
+void MotionTracker::assignConfig(const unsigned char *_values, size_t length) {
+	const unsigned char *end = _values + length;
+	short scale, gyroRate, accelRate, threshold;
+
+	if (!readShort(_values, end, scale) || !readShort(_values, end, gyroRate) || !readShort(_values, end, accelRate))
+		return;
+
+	// batch, channels, threshold, HPF and output mode
+	if (end - _values < 6)
+		return;
+
+	int batch = _values[0], channels = _values[1], hpfMode = _values[4], mode = _values[5];
+	_values += 2;
+	readShort(_values, end, threshold);
+
+	double newScaleRate;
 
-	if (scaleRate == 2000) {
-		scaleRate = 70.0 / 1000;
-	} else if (scaleRate == 500) {
-		scaleRate = 17.50 / 1000;
+	if (scale == 2000) {
+		newScaleRate = 70.0 / 1000;
+	} else if (scale == 500) {
+		newScaleRate = 17.50 / 1000;
 	} else {
-		scaleRate = 8.75 / 1000;
+		newScaleRate = 8.75 / 1000;
+	}
+
+	String description = StringConverter::toString(scale) + " dps, gyro " + StringConverter::toString(gyroRate)
+			+ " Hz in batches of " + StringConverter::toString(batch) + ", accel "
+			+ ((channels & CHANNEL_ACCEL) ? StringConverter::toString(accelRate) + " Hz" : String("off")) + ", mag "
+			+ ((channels & CHANNEL_MAG) ? "on" : "off") + ", temperature "
+			+ ((channels & CHANNEL_TEMP) ? "on" : "off") + ", threshold " + StringConverter::toString(threshold)
+			+ ", HPF mode " + StringConverter::toString(hpfMode)
+			+ (mode == MODE_ORIENTATION ? ", integrated on the device" : "");
+
+	// the config is repeated every second, only log changes
+	if (description != configDescription)
+		LogManager::getSingleton().logMessage("MotionTracker: " + description);
+
+	configDescription = description;
+	scaleRate = newScaleRate;
+	samplePeriod = gyroRate > 0 ? 1.0 / gyroRate : 0;
+	// same condition as hostThreshold() in Gyro.ino
+	zeroRateThreshold = toRadian(threshold * scaleRate);
+	hostThreshold = mode == MODE_SAMPLES && (channels & CHANNEL_TEMP);
+
+	// the device restarts from identity after a mode change
+	if (mode != deviceMode)
+		hasDeviceOrientation = false;
+
+	deviceMode = mode;
+}
+
+void MotionTracker::assignOrientation(const unsigned char *_values, size_t length) {
+	HMD_PROFILE("tracker/integrate");
+
+	if (scaleRate == 0 || length != 25)
+		return;
+
+	const unsigned char *end = _values + length;
+	const unsigned char *p = _values + 3;
+	size_t gyroCount = _values[2];
+	int w, x, y, z;
+	short gyroX, gyroY, gyroZ;
+
+	readInt(p, end, w);
+	readInt(p, end, x);
+	readInt(p, end, y);
+	readInt(p, end, z);
+	readShort(p, end, gyroX);
+	readShort(p, end, gyroY);
+	readShort(p, end, gyroZ);
+
+	Quaternion orientation(w / Q30_ONE, x / Q30_ONE, y / Q30_ONE, z / Q30_ONE);
+	orientation.normalise();
+	angularVelocity = Vector3(toRadian(gyroX * scaleRate), toRadian(gyroY * scaleRate), toRadian(gyroZ * scaleRate));
+
+	if (hasDeviceOrientation) {
+		Quaternion currentRot = *output * (deviceOrientation.Inverse() * orientation);
+		currentRot.normalise();
+		output->swap(currentRot);
+	}
+
+	deviceOrientation = orientation;
+	hasDeviceOrientation = true;
+	sampleCount += gyroCount;
+}
+
+void MotionTracker::assignAck(const unsigned char *_values, size_t length) {
+	if (length < 2)
+		return;
+
+	boost::mutex::scoped_lock lock(replyMutex);
+	ackCommand = _values[0];
+	ackStatus = _values[1];
+	replyReceived.notify_all();
+}
+
+void MotionTracker::assignCapabilities(const unsigned char *_values, size_t length) {
+	if (length < 5)
+		return;
+
+	boost::mutex::scoped_lock lock(replyMutex);
+	capabilities.version = _values[0];
+	capabilities.rates = _values[1];
+	capabilities.scales = _values[2];
+	capabilities.maxWatermark = _values[3];
+	capabilities.channels = _values[4];
+	capabilities.modes = length >= 6 ? _values[5] : 1 << MODE_SAMPLES;
+	capabilities.setupTransactions = length >= 10 ? (unsigned short) convert(_values[6], _values[7]) : 0;
+	capabilities.savedTransactions = length >= 10 ? (unsigned short) convert(_values[8], _values[9]) : 0;
+	capabilitiesReceived = true;
+	replyReceived.notify_all();
+}
+
+void MotionTracker::assignCalibration(const unsigned char *_values, size_t length) {
+	const unsigned char *end = _values + length;
+	const unsigned char *p = _values + 2;
+	short bias[3], noise[3], window;
+
+	if (length != 16)
+		return;
+
+	for (int axis = 0; axis < 3; axis++)
+		readShort(p, end, bias[axis]);
+	for (int axis = 0; axis < 3; axis++)
+		readShort(p, end, noise[axis]);
+	readShort(p, end, window);
+
+	// bias and noise in 1/16 raw gyro units
+	String description = _values[0] == CALIBRATION_STORED ? "stored zero rate" : "zero rate measured over "
+			+ StringConverter::toString(window) + " samples";
+	description += ", bias " + StringConverter::toString(bias[0] / 16.0f) + " " + StringConverter::toString(bias[1] / 16.0f)
+			+ " " + StringConverter::toString(bias[2] / 16.0f) + ", noise " + StringConverter::toString(noise[0] / 16.0f)
+			+ " " + StringConverter::toString(noise[1] / 16.0f) + " " + StringConverter::toString(noise[2] / 16.0f)
+			+ ", temperature " + StringConverter::toString((int) (signed char) _values[1]);
+
+	LogManager::getSingleton().logMessage("MotionTracker: " + description);
+
+	// what the model learned is relative to the old device bias
+	biasModel.reset();
+}
+
+void MotionTracker::sendPacket(unsigned char type, const unsigned char *payload, size_t length) {
+	std::vector<unsigned char> packet;
+	unsigned char checksum = type + length;
+
+	packet.push_back(PACKET_SYNC);
+	packet.push_back(type);
+	packet.push_back(length);
+
+	for (size_t i = 0; i < length; i++) {
+		packet.push_back(payload[i]);
+		checksum += payload[i];
+	}
+
+	packet.push_back(checksum);
+
+	// commands come from any thread, the port belongs to the io_service thread
+	io.post(boost::bind(&MotionTracker::queueWrite, this, packet));
+}
+
+bool MotionTracker::sendCommand(unsigned char type, const unsigned char *payload, size_t length) {
+	for (int attempt = 0; attempt < COMMAND_ATTEMPTS; attempt++) {
+		{
+			boost::mutex::scoped_lock lock(replyMutex);
+			ackCommand = -1;
+		}
+
+		sendPacket(type, payload, length);
+
+		boost::mutex::scoped_lock lock(replyMutex);
+		boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds(REPLY_TIMEOUT);
+
+		while (ackCommand != type) {
+			if (!replyReceived.timed_wait(lock, deadline))
+				break;
+		}
+
+		if (ackCommand == type)
+			return ackStatus == ACK_OK;
+	}
+
+	return false;
+}
+
+bool MotionTracker::queryCapabilities(Capabilities *_capabilities) {
+	for (int attempt = 0; attempt < COMMAND_ATTEMPTS; attempt++) {
+		{
+			boost::mutex::scoped_lock lock(replyMutex);
+			capabilitiesReceived = false;
+		}
+
+		sendPacket(CMD_QUERY, 0, 0);
+
+		boost::mutex::scoped_lock lock(replyMutex);
+		boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds(REPLY_TIMEOUT);
+
+		while (!capabilitiesReceived) {
+			if (!replyReceived.timed_wait(lock, deadline))
+				break;
+		}
+
+		if (capabilitiesReceived) {
+			*_capabilities = capabilities;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool MotionTracker::configure(const Config &config) {
+	Capabilities caps;
+
+	if (!queryCapabilities(&caps)) {
+		LogManager::getSingleton().logMessage("MotionTracker: no answer to the capability query, keeping the device settings");
+		return false;
+	}
+
+	LogManager::getSingleton().logMessage("MotionTracker: protocol " + StringConverter::toString(caps.version)
+			+ ", up to " + StringConverter::toString(caps.maxWatermark) + " gyro samples per packet");
+
+	if (caps.setupTransactions > 0)
+		LogManager::getSingleton().logMessage("MotionTracker: sensor setup took " + StringConverter::toString(caps.setupTransactions)
+				+ " I2C transactions, the register cache saved " + StringConverter::toString(caps.savedTransactions));
+
+	struct Setting {
+		const char *name;
+		unsigned char command;
+		int value;
+		size_t size;
+	} settings[] = {
+		{ "rate", CMD_SET_RATE, config.rate, 2 },
+		{ "scale", CMD_SET_SCALE, config.scale, 2 },
+		{ "watermark", CMD_SET_WATERMARK, config.watermark, 1 },
+		{ "channels", CMD_SET_CHANNELS, config.channels, 1 },
+		{ "threshold", CMD_SET_THRESHOLD, config.threshold, 2 },
+		{ "hpf", CMD_SET_HPF, config.hpfMode, 1 },
+		{ "mode", CMD_SET_MODE, config.mode, 1 },
+		{ "calibrate", CMD_CALIBRATE, config.calibrate, 2 }
+	};
+	bool ok = true;
+
+	for (size_t i = 0; i < sizeof(settings) / sizeof(settings[0]); i++) {
+		if (settings[i].value < 0)
+			continue;
+
+		unsigned char payload[2] = { (unsigned char) (settings[i].value & 0xFF), (unsigned char) ((settings[i].value >> 8) & 0xFF) };
+
+		if (!sendCommand(settings[i].command, payload, settings[i].size)) {
+			LogManager::getSingleton().logMessage("MotionTracker: " + String(settings[i].name) + " "
+					+ StringConverter::toString(settings[i].value) + " rejected or not acknowledged", LML_CRITICAL);
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
+void MotionTracker::calibrate(int window) {
+	{
+		boost::mutex::scoped_lock lock(replyMutex);
+		if (calibrating)
+			return;
+		calibrating = true;
 	}
 
-	double magX = convert(_values[12], _values[13]);
-	double magY = convert(_values[14], _values[15]);
-	double magZ = convert(_values[16], _values[17]);
+	// sendCommand waits for the acknowledgement, up to 3 x 200 ms: not on
+	// the caller's (render) thread, and not on the io_service thread that
+	// receives the acknowledgement
+	boost::thread thread(boost::bind(&MotionTracker::sendCalibrate, this, window));
+	thread.detach();
+}
+
+void MotionTracker::sendCalibrate(int window) {
+	unsigned char payload[2] = { (unsigned char) (window & 0xFF), (unsigned char) ((window >> 8) & 0xFF) };
+
+	if (sendCommand(CMD_CALIBRATE, payload, sizeof(payload)))
+		LogManager::getSingleton().logMessage("MotionTracker: calibrating, keep the tracker still");
+	else
+		LogManager::getSingleton().logMessage("MotionTracker: calibration rejected or not acknowledged", LML_CRITICAL);
+
+	boost::mutex::scoped_lock lock(replyMutex);
+	calibrating = false;
+}
+
+void MotionTracker::assignValues(const unsigned char *_values, size_t length) {
+	HMD_PROFILE("tracker/integrate");
+
+	// the gyro scale and rate are only known after the first config packet
+	if (scaleRate == 0 || samplePeriod == 0 || length < 4)
+		return;
+
+	// the packet interval (bytes 1 and 2) is clamped and, on a slow link,
+	// longer than the samples it carries; every FIFO sample covers 1 / ODR
+	const unsigned char *end = _values + length;
+	unsigned char flags = _values[0];
+	size_t gyroCount = _values[3];
+	const unsigned char *p = _values + 4;
+
+	if (gyroCount == 0)
+		return;
+
+	// first gyro sample absolute, the others delta encoded
+	std::vector<short> gyroValues(gyroCount * 3);
+
+	for (size_t i = 0; i < gyroCount; i++) {
+		for (size_t axis = 0; axis < 3; axis++) {
+			short &value = gyroValues[i * 3 + axis];
+
+			if (i == 0) {
+				if (!readShort(p, end, value))
+					return;
+			} else {
+				value = gyroValues[(i - 1) * 3 + axis];
+				if (!readDelta(p, end, value))
+					return;
+			}
+		}
+	}
+
+	size_t accelCount = 0;
+	const unsigned char *accelValues = 0;
+
+	if (flags & PACKET_HAS_ACCEL) {
+		if (p == end)
+			return;
+		accelCount = *p++;
+		accelValues = p;
+		if ((size_t) (end - p) < accelCount * SAMPLE_SIZE)
+			return;
+		p += accelCount * SAMPLE_SIZE;
+	}
+
+	if (flags & PACKET_HAS_MAG) {
+		short magX, magY, magZ;
+		if (!readShort(p, end, magX) || !readShort(p, end, magY) || !readShort(p, end, magZ))
+			return;
+		mag = Vector3(magX, magY, magZ);
+	}
+
+	if (flags & PACKET_HAS_TEMP) {
+		if (p == end)
+			return;
+		biasModel.setTemperature((signed char) *p++);
+	}
+
+	if (p != end)
+		return;
+
+	// each gyro sample is paired with the latest accel sample that was queued before it
+	for (size_t i = 0; i < gyroCount; i++) {
+		Vector3 gyro(toRadian(gyroValues[i * 3] * scaleRate),
+				toRadian(gyroValues[i * 3 + 1] * scaleRate),
+				toRadian(gyroValues[i * 3 + 2] * scaleRate));
 
+		biasModel.addSample(gyro, samplePeriod);
+		gyro -= biasModel.getBias();
+
+		if (hostThreshold) {
+			for (size_t axis = 0; axis < 3; axis++) {
+				if (fabs(gyro[axis]) <= zeroRateThreshold)
+					gyro[axis] = 0;
+			}
+		}
+
+		if (accelCount > 0) {
+			const unsigned char *a = accelValues + std::min(i * accelCount / gyroCount, accelCount - 1) * SAMPLE_SIZE;
+			Vector3 acc(convert(a[0], a[1]) / 256.0, convert(a[2], a[3]) / 256.0, convert(a[4], a[5]) / -256.0);
+			integrate(gyro, acc, samplePeriod);
+		} else {
+			integrate(gyro, avAcc, samplePeriod);
+		}
+	}
+
+	sampleCount += gyroCount;
+}
+
+void MotionTracker::integrate(const Vector3 &gyro, const Vector3 &acc, double timeDelta) {
 	/*
 	 * The Oculus Way ...
 	 *
@@ -78,10 +595,6 @@ void MotionTracker::assignValues(char *_values) {
 	 * Q = Q * deltaQ;
 	 *
 	 */
-	Vector3 gyro(toRadian(convert(_values[0], _values[1]) * scaleRate),
-			toRadian(convert(_values[2], _values[3]) * scaleRate),
-			toRadian(convert(_values[4], _values[5]) * scaleRate));
-
 	Vector3 rotationAxis(gyro);
 	rotationAxis.normalise();
 
@@ -92,10 +605,7 @@ void MotionTracker::assignValues(char *_values) {
 	currentRot.normalise();
 	currentRot = *output * currentRot;
 
-	avAcc = (avAcc
-			+ Vector3(convert(_values[6], _values[7]) / 256.0,
-					convert(_values[8], _values[9]) / 256.0,
-					convert(_values[10], _values[11]) / -256.0)) / 2.0;
+	avAcc = (avAcc + acc) / 2.0;
 
 	if (driftCounter == 2) {
 		driftCounter = 0;
@@ -121,6 +631,24 @@ void MotionTracker::assignValues(char *_values) {
 	output->swap(currentRot);
 }
 
+void MotionTracker::updateCounters() {
+	unsigned long now = timer.getMicroseconds();
+
+	if (now - lastStatsTime < STATS_INTERVAL)
+		return;
+
+	HMD::Profiler &profiler = HMD::Profiler::getSingleton();
+	profiler.setCounter("trackerSamplesPerSec", sampleCount * 1000000.0 / (now - lastStatsTime));
+	profiler.setCounter("trackerBytesPerSec", byteCount * 1000000.0 / (now - lastStatsTime));
+	profiler.setCounter("trackerChecksumErrors", checksumErrors);
+	profiler.setCounter("trackerGyroBias", biasModel.getBias().length() * 180 / M_PI);
+	profiler.setCounter("trackerBiasWindows", biasModel.getStationaryWindows());
+
+	sampleCount = 0;
+	byteCount = 0;
+	lastStatsTime = now;
+}
+
 short MotionTracker::convert(unsigned char lsb, unsigned char msb) {
 	short output = 0x0000;
 	output = output | msb;
@@ -2,29 +2,142 @@
 #define _MOTIONTRACKER_H_
 
 #include <OgreRoot.h>
+#include "GyroBiasModel.h"
 
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
+#include <deque>
+#include <vector>
 using namespace Ogre;
 using namespace ::boost::asio;
 
 class MotionTracker {
 	public:
-		void read();
-		static void create(Quaternion *_output);
+		// Output channels besides the gyro
+		enum Channel {
+			CHANNEL_ACCEL = 0x01,
+			CHANNEL_MAG = 0x02,
+			CHANNEL_TEMP = 0x04 // gyro temperature for the bias model, once per second
+		};
+
+		// What the device sends
+		enum Mode {
+			MODE_SAMPLES = 0, // every gyro sample, integrated here
+			MODE_ORIENTATION = 1 // orientation integrated on the device at the full rate
+		};
+
+		// Runtime sensor settings, -1 keeps the device setting
+		struct Config {
+			int rate; // gyro Hz: 100, 200, 400, 800
+			int scale; // gyro dps: 250, 500, 2000
+			int watermark; // gyro samples per packet
+			int channels; // Channel flags
+			int threshold; // zero rate threshold in raw gyro units
+			int hpfMode; // L3G4200D high pass filter mode 0-3
+			int mode; // Mode
+			int calibrate; // zero rate calibration window in gyro samples, 0 for the device default
+			Config() : rate(-1), scale(-1), watermark(-1), channels(-1), threshold(-1), hpfMode(-1), mode(-1), calibrate(-1) {}
+		};
+
+		// Answer to the capability query, rates and scales as bit masks
+		struct Capabilities {
+			int version;
+			int rates; // bit 0: 100 Hz ... bit 3: 800 Hz
+			int scales; // bit 0: 250, bit 1: 500, bit 2: 2000 dps
+			int maxWatermark;
+			int channels;
+			int modes; // bit per Mode
+			int setupTransactions; // I2C transactions of the sensor setup, 0 if unknown
+			int savedTransactions; // of those avoided by the I2Cdev register cache
+		};
+
+		// Runs the io_service of the port: reads and writes, until an error
+		void run();
+		// Opens the device and starts reading it on a background thread
+		static MotionTracker* create(Quaternion *_output);
+
+		// Queries the device, false if it does not answer (older firmware)
+		bool queryCapabilities(Capabilities *capabilities);
+		// Sends every setting that is not -1, false unless all were acknowledged
+		bool configure(const Config &config);
+		// Measures the gyro zero rate again, the device has to rest meanwhile.
+		// The device keeps it and skips the measurement on the next start.
+		// Returns right away, the command is sent on its own thread and the
+		// outcome logged; ignored while a calibration command is pending.
+		void calibrate(int window = 0);
 
     private:
         Quaternion* output;
         Vector3 avAcc;
         Vector3 tiltAxis;
+        io_service io;
         serial_port* serial;
         int driftCounter;
         Real compensationCounter;
+        // received bytes not yet parsed into a complete packet
+        std::vector<unsigned char> pending;
+        unsigned char readBuffer[256];
+        // packets waiting to be written, only touched by the io_service thread
+        std::deque<std::vector<unsigned char> > writeQueue;
+        // latest magnetometer measurement, raw
+        Vector3 mag;
+        // gyro degrees per second and LSB, from the config packet
+        double scaleRate;
+        // seconds between two gyro samples (1 / ODR), from the config packet
+        double samplePeriod;
+        // zero rate threshold in rad/s, applied here after the bias model when
+        // the device sends the temperature (and with it the samples unthresholded)
+        double zeroRateThreshold;
+        bool hostThreshold;
+        String configDescription;
+        int deviceMode;
+        // last orientation from the device, the host applies the rotation
+        // between two of them so resetting the head pose keeps working
+        Quaternion deviceOrientation;
+        bool hasDeviceOrientation;
+        // newest gyro sample of an orientation packet, rad/s
+        Vector3 angularVelocity;
+        // residual gyro bias over temperature, only in MODE_SAMPLES
+        GyroBiasModel biasModel;
+        unsigned long sampleCount;
+        unsigned long byteCount;
+        unsigned long checksumErrors;
+        unsigned long lastStatsTime;
+        Timer timer;
+        // command replies, written by the reading thread
+        boost::mutex replyMutex;
+        boost::condition_variable replyReceived;
+        int ackCommand;
+        int ackStatus;
+        bool capabilitiesReceived;
+        Capabilities capabilities;
+        // a calibrate() command is waiting for its acknowledgement
+        bool calibrating;
         MotionTracker(Quaternion* _output);
         ~MotionTracker();
 
         short convert(unsigned char lsb, unsigned char msb);
-        void assignValues(char *_values);
+        void startRead();
+        void handleRead(const boost::system::error_code &error, size_t length);
+        // Queues a packet on the io_service thread, writes it if none is in flight
+        void queueWrite(const std::vector<unsigned char> &packet);
+        void startWrite();
+        void handleWrite(const boost::system::error_code &error);
+        // Consumes all complete packets at the start of pending
+        void parsePackets();
+        void assignConfig(const unsigned char *_values, size_t length);
+        void assignOrientation(const unsigned char *_values, size_t length);
+        void assignAck(const unsigned char *_values, size_t length);
+        void assignCapabilities(const unsigned char *_values, size_t length);
+        void assignCalibration(const unsigned char *_values, size_t length);
+        void sendPacket(unsigned char type, const unsigned char *payload, size_t length);
+        // Sends the command until it is acknowledged, false if rejected or unanswered
+        bool sendCommand(unsigned char type, const unsigned char *payload, size_t length);
+        // Body of calibrate(), blocks for up to COMMAND_ATTEMPTS reply timeouts
+        void sendCalibrate(int window);
+        void assignValues(const unsigned char *_values, size_t length);
+        void integrate(const Vector3 &gyro, const Vector3 &acc, double timeDelta);
+        void updateCounters();
         double toRadian(double degree);
 };
 
@@ -1,6 +1,4 @@
 #include "OgreHmdDemo.h"
-#include "OculusCompositorListener.h"
-#include "MotionTracker/MotionTracker.h"
 
 #if OGRE_PLATFORM == OGRE_PLATFORM_APPLE_IOS || OGRE_PLATFORM == OGRE_PLATFORM_APPLE
 #   include <macUtils.h>
@@ -13,12 +11,15 @@ using namespace Ogre;
 #define CAMERA_RIGHT "RightCamera"
 #define COMPOSITOR_LEFT "OculusLeft"
 #define COMPOSITOR_RIGHT "OculusRight"
+#define COMPOSITOR_LEFT_REPROJECT "OculusLeftReproject"
+#define COMPOSITOR_RIGHT_REPROJECT "OculusRightReproject"
 
 namespace HMD {
 
 OgreHmdDemo::OgreHmdDemo() :
 		mHmdCfg(), mLeftViewport(0), mRightViewport(0),
-		mLeftCompositorListener(0), mRightCompositorListener(0) {
+		mHmdOptics(0), mStereoReprojection(0), mStereoVisibility(0), mSpectatorView(0), mSpectatorEnabled(false), mSceneStreamer(0), mLoadingScene(0),
+		mLoadStart(Profiler::getSingleton().now()), mMotionTracker(0), mTrackerConfigured(false) {
 	mHmdCfg.projectionCenterOffset = 0.13f;
 	mHmdCfg.interPupillaryDistance = 0.064f;
 	mHmdCfg.eyeToScreenDistance = 0.068f;
@@ -28,17 +29,30 @@ OgreHmdDemo::OgreHmdDemo() :
 	mHmdCfg.distortion.w = 0;
 	mHmdCfg.scale.x = 0.3;
 	mHmdCfg.scale.y = 0.343;
+
+	mSpectatorConfig.width = 640;
+	mSpectatorConfig.height = 400;
+	mSpectatorConfig.rate = 30;
+	mSpectatorConfig.offscreen = false;
 }
 
 OgreHmdDemo::~OgreHmdDemo() {
-	delete mLeftCompositorListener;
-	delete mRightCompositorListener;
+	delete mLoadingScene;
+	delete mSceneStreamer;
+	delete mSpectatorView;
+	delete mStereoReprojection;
+	delete mStereoVisibility;
+	delete mHmdOptics;
 }
 
 void OgreHmdDemo::go() {
-	// start MotionTracker
+	// start MotionTracker unless the head pose is scripted or nothing is shown
 	try {
-		MotionTracker::create(&mCameraRotation);
+		if (!mBenchmark && !mGoldenImageCheck && !mBuildShaderCache) {
+			mMotionTracker = MotionTracker::create(&mCameraRotation);
+			if (mTrackerConfigured)
+				mMotionTracker->configure(mTrackerConfig);
+		}
 	} catch(std::exception & e) {
 		printf("Error while connecting to MotionTracker: ", e.what());
 	}
@@ -46,39 +60,50 @@ void OgreHmdDemo::go() {
 	BaseApplication::go();
 }
 
+void OgreHmdDemo::setSpectator(const SpectatorView::Config &config, bool enabled) {
+	mSpectatorConfig = config;
+	mSpectatorEnabled = enabled;
+}
+
+void OgreHmdDemo::setTrackerConfig(const MotionTracker::Config &config) {
+	mTrackerConfig = config;
+	mTrackerConfigured = true;
+}
+
 //Local Functions
 void OgreHmdDemo::createScene() {
 	setupLight();
 	setupHmdPostProcessing();
 
+	// The content streams in while the loading scene is shown
+	mSceneStreamer = new SceneStreamer(mSceneMgr, mScriptLoader);
+	mLoadingScene = new LoadingScene(mSceneMgr, mBodyNode);
+
 	// Set up the cloudy skydome
-	mSceneMgr->setSkyDome(true, "Examples/CloudySky", 5, 8);
+	mSceneStreamer->setSkyDome("Examples/CloudySky", 5, 8);
 
 	SceneNode* rootNode = mSceneMgr->getRootSceneNode();
 
 	// add ogre heads
-	Entity* head1 = mSceneMgr->createEntity("Head1", "ogrehead.mesh");
 	SceneNode* head1Node = rootNode->createChildSceneNode("HeadNode1", Vector3(50, 50, 0));
-	head1Node->attachObject(head1);
+	mSceneStreamer->addEntity("Head1", "ogrehead.mesh", head1Node);
 
-	Entity* head2 = mSceneMgr->createEntity("Head2", "ogrehead.mesh");
 	SceneNode* head2Node = rootNode->createChildSceneNode("HeadNode2", Vector3(-50, 20, 0));
-	head2Node->attachObject(head2);
 	head2Node->scale(0.5f, 0.5f, 0.5f);
 	head2Node->yaw(Ogre::Degree(-45));
+	mSceneStreamer->addEntity("Head2", "ogrehead.mesh", head2Node);
 
 	// add houses
 	Vector3 housePositions[4] = {Vector3(1000, 500, 300), Vector3(-1000, 500, 500), Vector3(-300, 500, -900), Vector3(900, 500, -900)};
 
 	for (int i = 0; i < 4; i++) {
-		Entity* house = mSceneMgr->createEntity("tudorhouse.mesh");
-		house->setMaterialName("Examples/TudorHouse");
 		SceneNode* houseNode = rootNode->createChildSceneNode("HouseNode" + i, housePositions[i]);
 
 		if (i % 2 != 0)
 			houseNode->yaw(Degree(90), Node::TS_LOCAL);
 
-		houseNode->attachObject(house);
+		mSceneStreamer->addEntity("House" + StringConverter::toString(i), "tudorhouse.mesh", houseNode,
+				"Examples/TudorHouse");
 	}
 
 	// create ground
@@ -87,40 +112,88 @@ void OgreHmdDemo::createScene() {
 			ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, plane,
 			7000, 7000, 50, 50, true, 1, 5, 5, Vector3::UNIT_Z);
 
-	Entity* ground = mSceneMgr->createEntity("Ground", "ground");
-	ground->setMaterialName("Examples/Rockwall");
-	ground->setCastShadows(false);
-	rootNode->createChildSceneNode("GroundNode")->attachObject(ground);
+	mSceneStreamer->addEntity("Ground", "ground", rootNode->createChildSceneNode("GroundNode"),
+			"Examples/Rockwall", false);
+
+	// scripted and offscreen runs need the complete scene from the first frame
+	if (mBenchmark || mGoldenImageCheck || mBuildShaderCache) {
+		mSceneStreamer->waitUntilLoaded();
+		finishLoading();
+	}
+}
+
+void OgreHmdDemo::finishLoading() {
+	delete mLoadingScene;
+	mLoadingScene = 0;
+	LogManager::getSingleton().logMessage("Scene loaded after "
+			+ StringConverter::toString((Profiler::getSingleton().now() - mLoadStart) / 1000) + " ms");
+}
+
+bool OgreHmdDemo::frameRenderingQueued(const FrameEvent& evt) {
+	if (mLoadingScene) {
+		if (mSceneStreamer->isLoading())
+			mLoadingScene->setProgress(mSceneStreamer->getProgress());
+		else
+			finishLoading();
+	}
+
+	mStereoVisibility->updateCounters();
+
+	return BaseApplication::frameRenderingQueued(evt);
+}
+
+bool OgreHmdDemo::frameEnded(const FrameEvent& evt) {
+	bool result = BaseApplication::frameEnded(evt);
+
+	// the HMD frame is swapped, the spectator view queues behind it
+	mSpectatorView->frameEnded();
+
+	return result;
 }
 
 void OgreHmdDemo::setupHmdPostProcessing() {
+	mScriptLoader->ensureMaterial("Ogre/Compositor/Oculus");
+	mScriptLoader->ensureMaterial("Ogre/Compositor/Oculus/Depth");
+	mScriptLoader->ensureCompositor(COMPOSITOR_LEFT);
+	mScriptLoader->ensureCompositor(COMPOSITOR_RIGHT);
+	mScriptLoader->ensureCompositor(COMPOSITOR_LEFT_REPROJECT);
+	mScriptLoader->ensureCompositor(COMPOSITOR_RIGHT_REPROJECT);
+
+	// Both eyes reference the shared optics parameters, only the lens side differs
 	MaterialPtr matLeft = MaterialManager::getSingleton().getByName("Ogre/Compositor/Oculus");
 	MaterialPtr matRight = matLeft->clone("Ogre/Compositor/Oculus/Right");
-	GpuProgramParametersSharedPtr pParamsLeft = matLeft->getTechnique(0)->getPass(0)->getFragmentProgramParameters();
-	GpuProgramParametersSharedPtr pParamsRight = matRight->getTechnique(0)->getPass(0)->getFragmentProgramParameters();
+	matRight->getTechnique(0)->getPass(0)->getFragmentProgramParameters()->setNamedConstant("EyeSign", -1.0f);
 
-	pParamsLeft->setNamedConstant("Scale", mHmdCfg.scale);
-	pParamsRight->setNamedConstant("Scale", mHmdCfg.scale);
-	pParamsLeft->setNamedConstant("HmdWarpParam", mHmdCfg.distortion);
-	pParamsRight->setNamedConstant("HmdWarpParam", mHmdCfg.distortion);
-	pParamsLeft->setNamedConstant("LensCentre", 0.5f + mHmdCfg.projectionCenterOffset / 2.0f);
-	pParamsRight->setNamedConstant("LensCentre", 0.5f - mHmdCfg.projectionCenterOffset / 2.0f);
+	mHmdOptics = new HmdOptics(&mHmdCfg);
 
 	CompositorManager &compositorMngr = CompositorManager::getSingleton();
 
-	CompositorPtr comp = compositorMngr.getByName("OculusRight");
+	CompositorPtr comp = compositorMngr.getByName(COMPOSITOR_RIGHT);
+	comp->getTechnique(0)->getOutputTargetPass()->getPass(0)->setMaterialName("Ogre/Compositor/Oculus/Right");
+	comp = compositorMngr.getByName(COMPOSITOR_RIGHT_REPROJECT);
 	comp->getTechnique(0)->getOutputTargetPass()->getPass(0)->setMaterialName("Ogre/Compositor/Oculus/Right");
 
 	CompositorInstance* leftComp = compositorMngr.addCompositor(mLeftViewport, COMPOSITOR_LEFT);
 	CompositorInstance* rightComp = compositorMngr.addCompositor(mRightViewport, COMPOSITOR_RIGHT);
+	std::vector<CompositorInstance*> leftCompositors(1, leftComp);
 
-	mLeftCompositorListener = new OculusCompositorListener(&mHmdCfg, 1);
-	mRightCompositorListener = new OculusCompositorListener(&mHmdCfg, -1);
-
-	leftComp->addListener(mLeftCompositorListener);
-	rightComp->addListener(mRightCompositorListener);
+	mRenderProfiler->addCompositor(leftComp);
+	mRenderProfiler->addCompositor(rightComp);
 	leftComp->setEnabled(true);
 	rightComp->setEnabled(true);
+
+	// optional mode synthesizing the right eye from the left one
+	leftComp = compositorMngr.addCompositor(mLeftViewport, COMPOSITOR_LEFT_REPROJECT);
+	rightComp = compositorMngr.addCompositor(mRightViewport, COMPOSITOR_RIGHT_REPROJECT);
+	mRenderProfiler->addCompositor(leftComp);
+	mRenderProfiler->addCompositor(rightComp);
+
+	mStereoReprojection = new StereoReprojection(&mHmdCfg, leftComp, rightComp);
+
+	// mono view of the left eye before the lens warp, for spectators
+	leftCompositors.push_back(leftComp);
+	mSpectatorView = new SpectatorView(leftCompositors, mSpectatorConfig);
+	mSpectatorView->setEnabled(mSpectatorEnabled && !mBenchmark && !mGoldenImageCheck && !mBuildShaderCache);
 }
 
 void OgreHmdDemo::setupLight() {
@@ -151,8 +224,17 @@ void OgreHmdDemo::setupLight() {
 }
 
 void OgreHmdDemo::createCameras() {
-	mCameraNode->attachObject(createCamera(CAMERA_LEFT, -1));
-	mCameraNode->attachObject(createCamera(CAMERA_RIGHT, 1));
+	Camera *left = createCamera(CAMERA_LEFT, -1);
+	Camera *right = createCamera(CAMERA_RIGHT, 1);
+
+	// Both eyes select LOD levels and visible objects from the centre of the
+	// head, so an object never differs between the eyes
+	mStereoVisibility = new StereoVisibility(mSceneMgr, mCameraNode, mHmdCfg);
+	mStereoVisibility->attach(left);
+	mStereoVisibility->attach(right);
+
+	mCameraNode->attachObject(left);
+	mCameraNode->attachObject(right);
 }
 
 Camera* OgreHmdDemo::createCamera(const String &name, int factor) {
@@ -168,23 +250,27 @@ Camera* OgreHmdDemo::createCamera(const String &name, int factor) {
 	proj.setTrans(Vector3(-mHmdCfg.projectionCenterOffset * factor, 0, 0));
 	camera->setCustomProjectionMatrix(true, proj * camera->getProjectionMatrix());
 
+	mRenderProfiler->addCamera(camera);
+
 	return camera;
 }
 
 void OgreHmdDemo::createViewports() {
 	Camera *cam = mSceneMgr->getCamera(CAMERA_LEFT);
-	mLeftViewport = mWindow->addViewport(cam, 0, 0, 0, 0.5, 1);
+	mLeftViewport = mRenderTarget->addViewport(cam, 0, 0, 0, 0.5, 1);
 	mLeftViewport->setBackgroundColour(ColourValue::Black);
 	cam->setAspectRatio(
 			Real(mLeftViewport->getActualWidth())
 			/ Real(mLeftViewport->getActualHeight()));
 
 	cam = mSceneMgr->getCamera(CAMERA_RIGHT);
-	mRightViewport = mWindow->addViewport(cam, 1, 0.5, 0, 0.5, 1);
+	mRightViewport = mRenderTarget->addViewport(cam, 1, 0.5, 0, 0.5, 1);
 	mRightViewport->setBackgroundColour(ColourValue::Black);
 	cam->setAspectRatio(
 			Real(mRightViewport->getActualWidth())
 			/ Real(mRightViewport->getActualHeight()));
+
+	mStereoVisibility->setAspectRatio(cam->getAspectRatio());
 }
 
 bool OgreHmdDemo::keyPressed(const OIS::KeyEvent &evt) {
@@ -215,8 +301,20 @@ bool OgreHmdDemo::keyPressed(const OIS::KeyEvent &evt) {
 	case OIS::KC_8:
 		mHmdCfg.distortion.w -= 0.01;
 		break;
+	case OIS::KC_R: // toggle right eye reprojection
+		mStereoReprojection->setEnabled(!mStereoReprojection->isEnabled());
+		break;
+	case OIS::KC_M: // toggle the spectator view
+		mSpectatorView->setEnabled(!mSpectatorView->isEnabled());
+		break;
+	case OIS::KC_Z: // measure the gyro zero rate again, keep the tracker still
+		if (mMotionTracker)
+			mMotionTracker->calibrate();
+		break;
 	}
 
+	mHmdOptics->update();
+
 	return true;
 }
 
@@ -253,11 +351,111 @@ int main(int argc, char *argv[])
 #else
 	// Create application object
 	OgreHmdDemo app;
+	Benchmark benchmark;
+	GoldenImageCheck *goldenImageCheck = 0;
+	String benchmarkPath;
+	int status = 0;
+
+#if OGRE_PLATFORM != OGRE_PLATFORM_WIN32
+	// --benchmark [frames] [--path file] [--report file]
+	// --golden-record dir | --golden-check dir
+	// --build-shader-cache
+	// --record dir|file.mp4
+	// --frames-ahead n | --refresh Hz
+	// --spectator [WxH@rate] | --spectator-offscreen [WxH@rate]
+	// --tracker rate=Hz,scale=dps,watermark=n,channels=accel+mag+temp|none,threshold=n,hpf=mode,mode=samples|orientation,calibrate=n
+	for (int i = 1; i < argc; i++) {
+		String arg(argv[i]);
+
+		if (arg == "--benchmark") {
+			app.setBenchmark(&benchmark);
+			if (i + 1 < argc && StringConverter::isNumber(argv[i + 1]))
+				benchmark.setFrameCount(StringConverter::parseUnsignedInt(argv[++i]));
+		} else if (arg == "--path" && i + 1 < argc) {
+			benchmarkPath = argv[++i];
+		} else if (arg == "--report" && i + 1 < argc) {
+			benchmark.setReportFile(argv[++i]);
+		} else if ((arg == "--golden-record" || arg == "--golden-check") && i + 1 < argc) {
+			goldenImageCheck = new GoldenImageCheck(argv[++i], arg == "--golden-record");
+			app.setGoldenImageCheck(goldenImageCheck);
+		} else if (arg == "--build-shader-cache") {
+			app.setBuildShaderCache(true);
+		} else if (arg == "--record" && i + 1 < argc) {
+			app.setRecordOutput(argv[++i]);
+		} else if (arg == "--frames-ahead" && i + 1 < argc) {
+			app.setMaxFramesAhead(StringConverter::parseUnsignedInt(argv[++i], 1));
+		} else if (arg == "--refresh" && i + 1 < argc) {
+			app.setRefreshRate(StringConverter::parseReal(argv[++i]));
+		} else if (arg == "--spectator" || arg == "--spectator-offscreen") {
+			SpectatorView::Config config;
+			config.width = 640;
+			config.height = 400;
+			config.rate = 30;
+			config.offscreen = arg == "--spectator-offscreen";
+			int width = config.width, height = config.height;
+			float rate = config.rate;
+			if (i + 1 < argc && argv[i + 1][0] != '-'
+					&& (sscanf(argv[++i], "%dx%d@%f", &width, &height, &rate) != 3
+							|| width <= 0 || height <= 0 || !(rate > 0))) {
+				std::cerr << "Invalid spectator size " << argv[i] << ", expected WxH@rate with positive values, e.g. 640x400@30" << std::endl;
+				delete goldenImageCheck;
+				return 1;
+			}
+			config.width = width;
+			config.height = height;
+			config.rate = rate;
+			app.setSpectator(config, true);
+		} else if (arg == "--tracker" && i + 1 < argc) {
+			MotionTracker::Config config;
+			StringVector settings = StringUtil::split(argv[++i], ",");
+			for (size_t j = 0; j < settings.size(); j++) {
+				StringVector setting = StringUtil::split(settings[j], "=");
+				if (setting.size() != 2)
+					continue;
+				if (setting[0] == "rate")
+					config.rate = StringConverter::parseInt(setting[1]);
+				else if (setting[0] == "scale")
+					config.scale = StringConverter::parseInt(setting[1]);
+				else if (setting[0] == "watermark")
+					config.watermark = StringConverter::parseInt(setting[1]);
+				else if (setting[0] == "threshold")
+					config.threshold = StringConverter::parseInt(setting[1]);
+				else if (setting[0] == "hpf")
+					config.hpfMode = StringConverter::parseInt(setting[1]);
+				else if (setting[0] == "calibrate")
+					config.calibrate = StringConverter::parseInt(setting[1]);
+				else if (setting[0] == "mode")
+					config.mode = setting[1] == "orientation" ? MotionTracker::MODE_ORIENTATION : MotionTracker::MODE_SAMPLES;
+				else if (setting[0] == "channels")
+					config.channels = (setting[1].find("accel") != String::npos ? MotionTracker::CHANNEL_ACCEL : 0)
+							| (setting[1].find("mag") != String::npos ? MotionTracker::CHANNEL_MAG : 0)
+							| (setting[1].find("temp") != String::npos ? MotionTracker::CHANNEL_TEMP : 0);
+			}
+			app.setTrackerConfig(config);
+		}
+	}
+
+	// Without a complete reference set the check cannot pass
+	if (goldenImageCheck && !goldenImageCheck->isRecording() && !goldenImageCheck->hasGoldenImages()) {
+		std::cerr << "Golden image check failed: golden images missing in " << goldenImageCheck->getDirectory()
+				<< ", record them with --golden-record (make golden-record)" << std::endl;
+		delete goldenImageCheck;
+		return 1;
+	}
+#endif
 
 	try {
+		// a missing or malformed path is reported like any other startup error
+		if (!benchmarkPath.empty())
+			benchmark.loadPath(benchmarkPath);
+
 		// run application
 		app.go();
+
+		if (goldenImageCheck && goldenImageCheck->getFailureCount() > 0)
+			status = 1;
 	} catch (Ogre::Exception& e) {
+		status = 1;
 #if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
 		MessageBox( NULL, e.getFullDescription().c_str(), "An exception has occured!", MB_OK | MB_ICONERROR | MB_TASKMODAL);
 #else
@@ -265,8 +463,10 @@ int main(int argc, char *argv[])
 				<< e.getFullDescription().c_str() << std::endl;
 #endif
 	}
+
+	delete goldenImageCheck;
 #endif
-	return 0;
+	return status;
 }
 
 #ifdef __cplusplus
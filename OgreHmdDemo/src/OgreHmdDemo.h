@@ -3,7 +3,13 @@
 
 #include "BaseApplication.h"
 #include "HmdConfig.h"
-#include "OculusCompositorListener.h"
+#include "HmdOptics.h"
+#include "StereoReprojection.h"
+#include "StereoVisibility.h"
+#include "SpectatorView.h"
+#include "SceneStreamer.h"
+#include "LoadingScene.h"
+#include "MotionTracker/MotionTracker.h"
 
 using namespace Ogre;
 
@@ -14,6 +20,14 @@ public:
 	OgreHmdDemo(void);
 	virtual ~OgreHmdDemo(void);
 	virtual void go(void);
+	// Shows the spectator view from the start, key M toggles it
+	void setSpectator(const SpectatorView::Config &config, bool enabled);
+	// Sensor settings sent to the motion tracker after connecting
+	void setTrackerConfig(const MotionTracker::Config &config);
+
+	// Ogre::FrameListener
+	virtual bool frameRenderingQueued(const Ogre::FrameEvent& evt);
+	virtual bool frameEnded(const Ogre::FrameEvent& evt);
 
 protected:
 	virtual void createScene(void);
@@ -27,11 +41,22 @@ private:
 	HmdConfig mHmdCfg;
 	Viewport* mLeftViewport;
 	Viewport* mRightViewport;
-	OculusCompositorListener* mLeftCompositorListener;
-	OculusCompositorListener* mRightCompositorListener;
+	HmdOptics* mHmdOptics;
+	StereoReprojection* mStereoReprojection;
+	StereoVisibility* mStereoVisibility;
+	SpectatorView* mSpectatorView;
+	SpectatorView::Config mSpectatorConfig;
+	bool mSpectatorEnabled;
+	SceneStreamer* mSceneStreamer;
+	LoadingScene* mLoadingScene;
+	unsigned long mLoadStart;
+	MotionTracker* mMotionTracker;
+	MotionTracker::Config mTrackerConfig;
+	bool mTrackerConfigured;
 	Camera* createCamera(const String &name, int factor);
 	void setupLight(void);
 	void setupHmdPostProcessing(void);
+	void finishLoading(void);
 };
 }
 #endif // #ifndef __DualViewApplication_h_
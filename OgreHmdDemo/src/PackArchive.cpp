@@ -0,0 +1,196 @@
+#include "PackArchive.h"
+#include <cstring>
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+namespace HMD {
+
+PackArchive::PackArchive(const String &name, const String &archType) :
+		Archive(name, archType), mData(0), mSize(0) {
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	mFile = INVALID_HANDLE_VALUE;
+	mMapping = 0;
+#else
+	mFile = -1;
+#endif
+}
+
+PackArchive::~PackArchive() {
+	unload();
+}
+
+void PackArchive::load(void) {
+	if (mData)
+		return;
+
+	map();
+	readIndex();
+}
+
+void PackArchive::map(void) {
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	mFile = CreateFileA(mName.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+			FILE_FLAG_RANDOM_ACCESS, 0);
+
+	if (mFile == INVALID_HANDLE_VALUE)
+		OGRE_EXCEPT(Exception::ERR_FILE_NOT_FOUND, "Cannot open pack " + mName, "PackArchive::load");
+
+	mSize = GetFileSize(mFile, 0);
+	mMapping = CreateFileMappingA(mFile, 0, PAGE_READONLY, 0, 0, 0);
+	mData = mMapping ? (const uchar*) MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0) : 0;
+#else
+	struct stat info;
+	mFile = ::open(mName.c_str(), O_RDONLY);
+
+	if (mFile < 0 || fstat(mFile, &info) != 0)
+		OGRE_EXCEPT(Exception::ERR_FILE_NOT_FOUND, "Cannot open pack " + mName, "PackArchive::load");
+
+	mSize = info.st_size;
+	void *data = mmap(0, mSize, PROT_READ, MAP_SHARED, mFile, 0);
+	mData = data == MAP_FAILED ? 0 : (const uchar*) data;
+#endif
+
+	if (!mData) {
+		unload();
+		OGRE_EXCEPT(Exception::ERR_INTERNAL_ERROR, "Cannot map pack " + mName, "PackArchive::load");
+	}
+}
+
+void PackArchive::readIndex(void) {
+	const PackHeader *header = (const PackHeader*) mData;
+
+	if (mSize < sizeof(PackHeader) || memcmp(header->magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0
+			|| header->version != PACK_VERSION
+			|| mSize < sizeof(PackHeader) + header->entryCount * sizeof(PackEntry)) {
+		unload();
+		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, mName + " is not a resource pack", "PackArchive::load");
+	}
+
+	const PackEntry *entries = (const PackEntry*) (mData + sizeof(PackHeader));
+	mFiles.resize(header->entryCount);
+
+	for (size_t i = 0; i < mFiles.size(); i++) {
+		const PackEntry &entry = entries[i];
+
+		if (entry.nameOffset + entry.nameLength > mSize || entry.dataOffset + entry.size > mSize) {
+			unload();
+			OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, mName + " is corrupt", "PackArchive::load");
+		}
+
+		FileInfo &file = mFiles[i];
+		file.archive = this;
+		file.filename = String((const char*) mData + entry.nameOffset, entry.nameLength);
+		file.basename = file.filename;
+		file.path = StringUtil::BLANK;
+		file.compressedSize = entry.size;
+		file.uncompressedSize = entry.size;
+		mIndex[file.filename] = i;
+	}
+
+	LogManager::getSingleton().logMessage("Mapped pack " + mName + " with "
+			+ StringConverter::toString(mFiles.size()) + " files");
+}
+
+void PackArchive::unload(void) {
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	if (mData)
+		UnmapViewOfFile(mData);
+	if (mMapping)
+		CloseHandle(mMapping);
+	if (mFile != INVALID_HANDLE_VALUE)
+		CloseHandle(mFile);
+
+	mMapping = 0;
+	mFile = INVALID_HANDLE_VALUE;
+#else
+	if (mData)
+		munmap((void*) mData, mSize);
+	if (mFile >= 0)
+		::close(mFile);
+
+	mFile = -1;
+#endif
+	mData = 0;
+	mSize = 0;
+	mFiles.clear();
+	mIndex.clear();
+}
+
+DataStreamPtr PackArchive::open(const String &filename, bool readOnly) const {
+	std::map<String, size_t>::const_iterator it = mIndex.find(filename);
+
+	if (it == mIndex.end())
+		return DataStreamPtr();
+
+	// no copy: the stream reads the mapped pages directly
+	const PackEntry &entry = ((const PackEntry*) (mData + sizeof(PackHeader)))[it->second];
+	return DataStreamPtr(OGRE_NEW MemoryDataStream(filename, (void*) (mData + entry.dataOffset),
+			entry.size, false, true));
+}
+
+StringVectorPtr PackArchive::list(bool recursive, bool dirs) {
+	return find("*", recursive, dirs);
+}
+
+FileInfoListPtr PackArchive::listFileInfo(bool recursive, bool dirs) {
+	return findFileInfo("*", recursive, dirs);
+}
+
+bool PackArchive::matches(const FileInfo &file, const String &pattern) const {
+	return StringUtil::match(file.filename, pattern, true);
+}
+
+StringVectorPtr PackArchive::find(const String &pattern, bool recursive, bool dirs) {
+	StringVectorPtr names(OGRE_NEW_T(StringVector, MEMCATEGORY_GENERAL)(), SPFM_DELETE_T);
+
+	// packs only contain files
+	if (!dirs) {
+		for (size_t i = 0; i < mFiles.size(); i++) {
+			if (matches(mFiles[i], pattern))
+				names->push_back(mFiles[i].filename);
+		}
+	}
+
+	return names;
+}
+
+FileInfoListPtr PackArchive::findFileInfo(const String &pattern, bool recursive, bool dirs) const {
+	FileInfoListPtr files(OGRE_NEW_T(FileInfoList, MEMCATEGORY_GENERAL)(), SPFM_DELETE_T);
+
+	if (!dirs) {
+		for (size_t i = 0; i < mFiles.size(); i++) {
+			if (matches(mFiles[i], pattern))
+				files->push_back(mFiles[i]);
+		}
+	}
+
+	return files;
+}
+
+bool PackArchive::exists(const String &filename) {
+	return mIndex.find(filename) != mIndex.end();
+}
+
+time_t PackArchive::getModifiedTime(const String &filename) {
+	std::map<String, size_t>::const_iterator it = mIndex.find(filename);
+
+	if (it == mIndex.end())
+		return 0;
+
+	return ((const PackEntry*) (mData + sizeof(PackHeader)))[it->second].modifiedTime;
+}
+
+const String& PackArchiveFactory::getType(void) const {
+	static String type = "Pack";
+	return type;
+}
+
+} /* namespace HMD */
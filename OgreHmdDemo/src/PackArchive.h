@@ -0,0 +1,62 @@
+#ifndef __PackArchive_h_
+#define __PackArchive_h_
+
+#include <OgreRoot.h>
+#include <OgreArchive.h>
+#include <OgreArchiveFactory.h>
+#include "PackFormat.h"
+
+namespace HMD {
+
+using namespace Ogre;
+
+/*
+ * Archive for resource packs (see PackFormat.h). The pack is memory mapped on
+ * load and streams are served straight from the mapping, so nothing is read
+ * or inflated up front and only the pages actually used become resident.
+ * Register the PackArchiveFactory and use "Pack" as location type.
+ */
+class PackArchive: public Archive {
+public:
+	PackArchive(const String &name, const String &archType);
+	~PackArchive();
+
+	bool isCaseSensitive(void) const { return true; }
+	void load(void);
+	void unload(void);
+
+	DataStreamPtr open(const String &filename, bool readOnly = true) const;
+	StringVectorPtr list(bool recursive = true, bool dirs = false);
+	FileInfoListPtr listFileInfo(bool recursive = true, bool dirs = false);
+	StringVectorPtr find(const String &pattern, bool recursive = true, bool dirs = false);
+	FileInfoListPtr findFileInfo(const String &pattern, bool recursive = true, bool dirs = false) const;
+	bool exists(const String &filename);
+	time_t getModifiedTime(const String &filename);
+
+private:
+	const uchar *mData;
+	size_t mSize;
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	void *mFile;
+	void *mMapping;
+#else
+	int mFile;
+#endif
+	std::vector<FileInfo> mFiles;
+	std::map<String, size_t> mIndex;
+
+	void map(void);
+	void readIndex(void);
+	bool matches(const FileInfo &file, const String &pattern) const;
+};
+
+class PackArchiveFactory: public ArchiveFactory {
+public:
+	const String& getType(void) const;
+	Archive* createInstance(const String &name) { return OGRE_NEW PackArchive(name, getType()); }
+	Archive* createInstance(const String &name, bool readOnly) { return createInstance(name); }
+	void destroyInstance(Archive *archive) { OGRE_DELETE archive; }
+};
+
+} /* namespace HMD */
+#endif // #ifndef __PackArchive_h_
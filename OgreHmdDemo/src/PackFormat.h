@@ -0,0 +1,35 @@
+#ifndef __PackFormat_h_
+#define __PackFormat_h_
+
+#include <OgrePlatform.h>
+
+namespace HMD {
+
+/*
+ * Layout of a resource pack (.pack), an uncompressed, indexed archive which
+ * is memory mapped as a whole:
+ *   PackHeader | PackEntry[entryCount] | names | padding | data ...
+ * Every file's data starts at a multiple of PACK_ALIGNMENT. Offsets are
+ * relative to the start of the file, all values are little endian.
+ */
+#define PACK_MAGIC "HMDPACK"
+#define PACK_VERSION 1
+#define PACK_ALIGNMENT 64
+
+struct PackHeader {
+	char magic[8];
+	Ogre::uint32 version;
+	Ogre::uint32 entryCount;
+};
+
+struct PackEntry {
+	Ogre::uint32 nameOffset;
+	Ogre::uint32 nameLength;
+	Ogre::uint32 dataOffset;
+	Ogre::uint32 size;
+	Ogre::uint32 modifiedTime;
+	Ogre::uint32 reserved;
+};
+
+} /* namespace HMD */
+#endif // #ifndef __PackFormat_h_
@@ -0,0 +1,164 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <fstream>
+
+#define RING_BUFFER_SIZE 16384
+
+namespace HMD {
+
+Profiler& Profiler::getSingleton() {
+	static Profiler profiler;
+	return profiler;
+}
+
+Profiler::Profiler() :
+		mThreadBuffer(keepThreadBuffer) {
+}
+
+void Profiler::keepThreadBuffer(ThreadBuffer *buffer) {
+	// Buffers stay registered after their thread ended, so they must not be deleted
+}
+
+Profiler::ThreadBuffer* Profiler::createThreadBuffer() {
+	ThreadBuffer *buffer = new ThreadBuffer();
+	buffer->events.resize(RING_BUFFER_SIZE);
+	buffer->head = 0;
+
+	boost::mutex::scoped_lock lock(mBuffersMutex);
+	buffer->threadId = mBuffers.size();
+	mBuffers.push_back(buffer);
+	mThreadBuffer.reset(buffer);
+
+	return buffer;
+}
+
+void Profiler::record(const char *name, unsigned long start, unsigned long duration) {
+	ThreadBuffer *buffer = mThreadBuffer.get();
+
+	if (!buffer)
+		buffer = createThreadBuffer();
+
+	unsigned long head = buffer->head.load(boost::memory_order_relaxed);
+	Event &event = buffer->events[head % RING_BUFFER_SIZE];
+
+	event.name = name;
+	event.start = start;
+	event.duration = duration;
+
+	// Publish the event to readers
+	buffer->head.store(head + 1, boost::memory_order_release);
+}
+
+void Profiler::setCounter(const String &name, double value) {
+	boost::mutex::scoped_lock lock(mCountersMutex);
+	mCounters[name] = value;
+}
+
+std::vector<Profiler::Event> Profiler::snapshot(const ThreadBuffer *buffer) {
+	unsigned long head = buffer->head.load(boost::memory_order_acquire);
+	unsigned long count = std::min(head, (unsigned long) RING_BUFFER_SIZE);
+	std::vector<Event> events;
+
+	events.reserve(count);
+
+	// The oldest events may be overwritten while copying, this is accepted
+	// in favour of never blocking the recording threads
+	for (unsigned long i = head - count; i < head; i++)
+		events.push_back(buffer->events[i % RING_BUFFER_SIZE]);
+
+	return events;
+}
+
+static Real percentile(const std::vector<unsigned long> &sorted, Real p) {
+	return sorted[std::min(sorted.size() - 1, (size_t) (p * sorted.size()))] / 1000.0f;
+}
+
+std::map<String, Profiler::Stats> Profiler::getStats() {
+	std::map<String, std::vector<unsigned long> > durations;
+	std::map<String, Stats> stats;
+	std::vector<ThreadBuffer*> buffers;
+
+	{
+		boost::mutex::scoped_lock lock(mBuffersMutex);
+		buffers = mBuffers;
+	}
+
+	for (size_t i = 0; i < buffers.size(); i++) {
+		std::vector<Event> events = snapshot(buffers[i]);
+
+		for (size_t j = 0; j < events.size(); j++)
+			durations[events[j].name].push_back(events[j].duration);
+	}
+
+	for (std::map<String, std::vector<unsigned long> >::iterator it = durations.begin(); it != durations.end(); ++it) {
+		std::vector<unsigned long> &sorted = it->second;
+		std::sort(sorted.begin(), sorted.end());
+
+		Stats &s = stats[it->first];
+		s.count = sorted.size();
+		s.p50 = percentile(sorted, 0.5f);
+		s.p95 = percentile(sorted, 0.95f);
+		s.p99 = percentile(sorted, 0.99f);
+		s.max = sorted.back() / 1000.0f;
+	}
+
+	return stats;
+}
+
+void Profiler::logStats() {
+	LogManager &log = LogManager::getSingleton();
+	std::map<String, Stats> stats = getStats();
+
+	log.logMessage("*** Frame timings (ms): p50 p95 p99 max [samples] ***");
+
+	for (std::map<String, Stats>::iterator it = stats.begin(); it != stats.end(); ++it) {
+		const Stats &s = it->second;
+		log.logMessage(it->first + ": " + StringConverter::toString(s.p50) + " "
+				+ StringConverter::toString(s.p95) + " " + StringConverter::toString(s.p99) + " "
+				+ StringConverter::toString(s.max) + " [" + StringConverter::toString(s.count) + "]");
+	}
+
+	boost::mutex::scoped_lock lock(mCountersMutex);
+
+	for (std::map<String, double>::iterator it = mCounters.begin(); it != mCounters.end(); ++it)
+		log.logMessage(it->first + " = " + StringConverter::toString((Real) it->second));
+}
+
+void Profiler::writeChromeTrace(const String &fileName) {
+	std::ofstream out(fileName.c_str());
+	std::vector<ThreadBuffer*> buffers;
+	bool first = true;
+
+	{
+		boost::mutex::scoped_lock lock(mBuffersMutex);
+		buffers = mBuffers;
+	}
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	for (size_t i = 0; i < buffers.size(); i++) {
+		std::vector<Event> events = snapshot(buffers[i]);
+
+		for (size_t j = 0; j < events.size(); j++) {
+			out << (first ? "\n" : ",\n") << "{\"name\":\"" << events[j].name
+					<< "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffers[i]->threadId
+					<< ",\"ts\":" << events[j].start << ",\"dur\":" << events[j].duration << "}";
+			first = false;
+		}
+	}
+
+	out << "\n],\"otherData\":{";
+
+	{
+		boost::mutex::scoped_lock lock(mCountersMutex);
+
+		for (std::map<String, double>::iterator it = mCounters.begin(); it != mCounters.end(); ++it)
+			out << (it == mCounters.begin() ? "" : ",") << "\"" << it->first << "\":" << it->second;
+	}
+
+	out << "}}\n";
+
+	LogManager::getSingleton().logMessage("Wrote frame trace to " + fileName);
+}
+
+} /* namespace HMD */
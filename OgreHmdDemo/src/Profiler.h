@@ -0,0 +1,91 @@
+#ifndef __Profiler_h_
+#define __Profiler_h_
+
+#include <OgreRoot.h>
+#include <OgreTimer.h>
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+#include <vector>
+#include <map>
+
+namespace HMD {
+
+using namespace Ogre;
+
+/*
+ * Low overhead timing instrumentation. Every thread records its timings into
+ * an own fixed size ring buffer, so recording never takes a lock. The buffers
+ * are only read on demand to log rolling percentiles or to dump a Chrome trace
+ * (load it via chrome://tracing).
+ */
+class Profiler {
+public:
+	struct Event {
+		const char *name; // has to outlive the recorded data, e.g. a string literal
+		unsigned long start;
+		unsigned long duration;
+	};
+
+	struct Stats {
+		size_t count;
+		Real p50;
+		Real p95;
+		Real p99;
+		Real max;
+	};
+
+	static Profiler& getSingleton();
+
+	unsigned long now() { return mTimer.getMicroseconds(); }
+	// Records a finished timing of the calling thread
+	void record(const char *name, unsigned long start, unsigned long duration);
+	// Named value shown next to the timings, e.g. a counter or a measured fraction
+	void setCounter(const String &name, double value);
+
+	// Percentiles in ms over the events still held by the ring buffers
+	std::map<String, Stats> getStats();
+	void logStats(void);
+	void writeChromeTrace(const String &fileName);
+
+private:
+	// Single producer ring buffer, overwrites the oldest events when full
+	struct ThreadBuffer {
+		std::vector<Event> events;
+		boost::atomic<unsigned long> head;
+		unsigned int threadId;
+	};
+
+	Timer mTimer;
+	boost::thread_specific_ptr<ThreadBuffer> mThreadBuffer;
+	std::vector<ThreadBuffer*> mBuffers;
+	boost::mutex mBuffersMutex;
+	std::map<String, double> mCounters;
+	boost::mutex mCountersMutex;
+
+	Profiler();
+	static void keepThreadBuffer(ThreadBuffer *buffer);
+	ThreadBuffer* createThreadBuffer(void);
+	std::vector<Event> snapshot(const ThreadBuffer *buffer);
+};
+
+// Records the time between construction and destruction
+class ScopedTimer {
+public:
+	ScopedTimer(const char *name) :
+			mName(name), mStart(Profiler::getSingleton().now()) {
+	}
+	~ScopedTimer() {
+		Profiler &profiler = Profiler::getSingleton();
+		profiler.record(mName, mStart, profiler.now() - mStart);
+	}
+private:
+	const char *mName;
+	unsigned long mStart;
+};
+
+#define HMD_PROFILE_CONCAT_(a, b) a##b
+#define HMD_PROFILE_CONCAT(a, b) HMD_PROFILE_CONCAT_(a, b)
+#define HMD_PROFILE(name) HMD::ScopedTimer HMD_PROFILE_CONCAT(scopedTimer, __LINE__)(name)
+
+} /* namespace HMD */
+#endif // #ifndef __Profiler_h_
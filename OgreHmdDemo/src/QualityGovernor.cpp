@@ -0,0 +1,160 @@
+#include "QualityGovernor.h"
+#include "Profiler.h"
+#include <OgreEntity.h>
+#include <OgreSubEntity.h>
+#include <algorithm>
+
+#define WINDOW_FRAMES 45
+// Thresholds of the 90th percentile busy time against the budget
+#define OVER_BUDGET 0.95f
+#define HEADROOM 0.70f
+#define OVER_WINDOWS 2
+#define UNDER_WINDOWS 6
+#define COOLDOWN_WINDOWS 3
+#define DEFAULT_SKY_SEGMENTS 16
+
+namespace HMD {
+
+static QualityGovernor::Level createLevel(const char *name, int skySegments, Real lodBias, ShadowTechnique shadowTechnique) {
+	QualityGovernor::Level level;
+	level.name = name;
+	level.skySegments = skySegments;
+	level.lodBias = lodBias;
+	level.shadowTechnique = shadowTechnique;
+	return level;
+}
+
+static const char* getShadowName(ShadowTechnique technique) {
+	switch (technique) {
+	case SHADOWTYPE_NONE:
+		return "none";
+	case SHADOWTYPE_STENCIL_ADDITIVE:
+		return "stencil additive";
+	case SHADOWTYPE_STENCIL_MODULATIVE:
+		return "stencil modulative";
+	default:
+		return "other";
+	}
+}
+
+QualityGovernor::QualityGovernor(SceneManager *sceneMgr, Real refreshRate) :
+		mSceneMgr(sceneMgr), mEnabled(true), mBudget((unsigned long) (1000000 / refreshRate)),
+		mLevel(0), mOverWindows(0), mUnderWindows(0), mCooldownWindows(0),
+		mSkySegments(DEFAULT_SKY_SEGMENTS) {
+	// ordered by what is noticed least in the headset
+	ShadowTechnique shadows = mSceneMgr->getShadowTechnique();
+	mLadder.push_back(createLevel("full", DEFAULT_SKY_SEGMENTS, 1, shadows));
+	mLadder.push_back(createLevel("coarse sky", 8, 1, shadows));
+	mLadder.push_back(createLevel("near LOD", 8, 0.5f, shadows));
+	mLadder.push_back(createLevel("modulative shadows", 8, 0.5f, SHADOWTYPE_STENCIL_MODULATIVE));
+	mLadder.push_back(createLevel("nearest LOD", 4, 0.25f, SHADOWTYPE_STENCIL_MODULATIVE));
+	mLadder.push_back(createLevel("no shadows", 4, 0.25f, SHADOWTYPE_NONE));
+
+	mWindow.reserve(WINDOW_FRAMES);
+	Profiler::getSingleton().setCounter("qualityLevel", 0);
+}
+
+void QualityGovernor::addFrame(unsigned long microseconds) {
+	if (!mEnabled)
+		return;
+
+	mWindow.push_back(microseconds);
+
+	if (mWindow.size() == WINDOW_FRAMES) {
+		evaluateWindow();
+		mWindow.clear();
+	}
+}
+
+void QualityGovernor::setEnabled(bool enabled) {
+	mEnabled = enabled;
+	mWindow.clear();
+	mOverWindows = mUnderWindows = 0;
+
+	if (!enabled)
+		setLevel(0, "governor disabled");
+	else
+		LogManager::getSingleton().logMessage("Quality governor enabled");
+}
+
+void QualityGovernor::evaluateWindow() {
+	std::sort(mWindow.begin(), mWindow.end());
+	unsigned long busy = mWindow[mWindow.size() * 9 / 10];
+
+	// the sky dome is streamed in, give it the segments of the current level
+	applySkySegments();
+
+	if (mCooldownWindows > 0) {
+		mCooldownWindows--;
+		return;
+	}
+
+	if (busy > mBudget * OVER_BUDGET) {
+		mOverWindows++;
+		mUnderWindows = 0;
+	} else if (busy < mBudget * HEADROOM) {
+		mUnderWindows++;
+		mOverWindows = 0;
+	} else {
+		mOverWindows = mUnderWindows = 0;
+	}
+
+	String reason = "p90 busy " + StringConverter::toString(busy / 1000.0f, 3) + " ms, budget "
+			+ StringConverter::toString(mBudget / 1000.0f, 3) + " ms";
+
+	if (mOverWindows >= OVER_WINDOWS && mLevel + 1 < mLadder.size())
+		setLevel(mLevel + 1, reason);
+	else if (mUnderWindows >= UNDER_WINDOWS && mLevel > 0)
+		setLevel(mLevel - 1, reason);
+}
+
+void QualityGovernor::setLevel(size_t level, const String &reason) {
+	const Level &from = mLadder[mLevel];
+	const Level &to = mLadder[level];
+	String changes;
+
+	if (to.shadowTechnique != from.shadowTechnique) {
+		mSceneMgr->setShadowTechnique(to.shadowTechnique);
+		changes += String(", shadows ") + getShadowName(to.shadowTechnique);
+	}
+
+	if (to.lodBias != from.lodBias) {
+		SceneManager::CameraIterator it = mSceneMgr->getCameraIterator();
+
+		while (it.hasMoreElements())
+			it.getNext()->setLodBias(to.lodBias);
+
+		changes += ", LOD bias " + StringConverter::toString(to.lodBias);
+	}
+
+	if (to.skySegments != from.skySegments)
+		changes += ", sky segments " + StringConverter::toString(to.skySegments);
+
+	if (level != mLevel)
+		LogManager::getSingleton().logMessage("Quality governor: level " + StringConverter::toString(mLevel)
+				+ " -> " + StringConverter::toString(level) + " (" + to.name + ") at " + reason + changes);
+
+	mLevel = level;
+	mOverWindows = mUnderWindows = 0;
+	mCooldownWindows = COOLDOWN_WINDOWS;
+	applySkySegments();
+	Profiler::getSingleton().setCounter("qualityLevel", mLevel);
+}
+
+void QualityGovernor::applySkySegments() {
+	int segments = mLadder[mLevel].skySegments;
+
+	if (segments == mSkySegments || !mSceneMgr->isSkyDomeEnabled())
+		return;
+
+	// the dome is rebuilt with the same material and shape, only coarser or finer
+	Entity *dome = static_cast<Entity*>(mSceneMgr->getSkyDomeNode()->getAttachedObject(0));
+	String material = dome->getSubEntity(0)->getMaterialName();
+	SceneManager::SkyDomeGenParameters params = mSceneMgr->getSkyDomeGenParameters();
+
+	mSceneMgr->setSkyDome(true, material, params.skyDomeCurvature, params.skyDomeTiling,
+			params.skyDomeDistance, true, Quaternion::IDENTITY, segments, segments, params.skyDomeYSegments_keep);
+	mSkySegments = segments;
+}
+
+} /* namespace HMD */
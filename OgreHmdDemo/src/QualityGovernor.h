@@ -0,0 +1,59 @@
+#ifndef __QualityGovernor_h_
+#define __QualityGovernor_h_
+
+#include <OgreRoot.h>
+#include <OgreSceneManager.h>
+#include <vector>
+
+namespace HMD {
+
+using namespace Ogre;
+
+/*
+ * Keeps the frame time within the display budget by stepping through a
+ * quality ladder: each level gives up a bit more of sky dome tessellation,
+ * mesh LOD distance and shadow quality. The busy time of the frames (frame
+ * time minus the voluntary wait for the pose deadline) is collected in
+ * windows; a level is dropped after consecutive windows over budget and
+ * regained only after several windows with plenty of headroom, with a
+ * cooldown after every transition so the levels do not oscillate.
+ */
+class QualityGovernor {
+public:
+	struct Level {
+		const char *name;
+		int skySegments;
+		Real lodBias;
+		ShadowTechnique shadowTechnique;
+	};
+
+	QualityGovernor(SceneManager *sceneMgr, Real refreshRate);
+
+	// Busy time of the last frame
+	void addFrame(unsigned long microseconds);
+
+	void setEnabled(bool enabled);
+	bool isEnabled() const { return mEnabled; }
+	size_t getLevel() const { return mLevel; }
+
+private:
+	SceneManager *mSceneMgr;
+	std::vector<Level> mLadder;
+	bool mEnabled;
+	unsigned long mBudget;
+	std::vector<unsigned long> mWindow;
+	size_t mLevel;
+	// Consecutive windows over budget and with headroom
+	unsigned int mOverWindows;
+	unsigned int mUnderWindows;
+	unsigned int mCooldownWindows;
+	// Sky dome segments in use, the sky may only appear after streaming
+	int mSkySegments;
+
+	void evaluateWindow(void);
+	void setLevel(size_t level, const String &reason);
+	void applySkySegments(void);
+};
+
+} /* namespace HMD */
+#endif // #ifndef __QualityGovernor_h_
@@ -0,0 +1,105 @@
+#include "RenderProfiler.h"
+#include <OgreCompositor.h>
+#include <OgreCompositionTechnique.h>
+#include <OgreViewport.h>
+
+namespace HMD {
+
+RenderProfiler::RenderProfiler(RenderTarget *window) :
+		mWindow(window) {
+	mWindow->addListener(this);
+}
+
+RenderProfiler::~RenderProfiler() {
+	mWindow->removeListener(this);
+
+	for (size_t i = 0; i < mCameras.size(); i++)
+		mCameras[i]->removeListener(this);
+
+	for (size_t i = 0; i < mCompositorHooks.size(); i++) {
+		mCompositorHooks[i]->compositor->removeListener(mCompositorHooks[i]);
+		delete mCompositorHooks[i];
+	}
+}
+
+void RenderProfiler::addCamera(Camera *camera) {
+	setName(camera, "scene/" + camera->getName());
+	camera->addListener(this);
+	mCameras.push_back(camera);
+}
+
+void RenderProfiler::addCompositor(CompositorInstance *compositor) {
+	CompositorHook *hook = new CompositorHook(this, compositor);
+	compositor->addListener(hook);
+	mCompositorHooks.push_back(hook);
+}
+
+RenderProfiler::CompositorHook::CompositorHook(RenderProfiler *profiler, CompositorInstance *compositor) :
+		compositor(compositor), mProfiler(profiler) {
+}
+
+void RenderProfiler::CompositorHook::notifyResourcesCreated(bool forResizeOnly) {
+	CompositionTechnique::TextureDefinitionIterator it = compositor->getTechnique()->getTextureDefinitionIterator();
+
+	while (it.hasMoreElements()) {
+		CompositionTechnique::TextureDefinition *def = it.getNext();
+
+		// Referenced textures are timed by the compositor defining them
+		if (!def->refCompName.empty())
+			continue;
+
+		RenderTarget *target = compositor->getRenderTarget(def->name);
+		mProfiler->setName(target, "compositor/" + compositor->getCompositor()->getName() + "/" + def->name);
+		target->addListener(mProfiler);
+	}
+}
+
+void RenderProfiler::preViewportUpdate(const RenderTargetViewportEvent &evt) {
+	if (mObjectNames.find(evt.source) == mObjectNames.end())
+		setName(evt.source, "viewport/" + evt.source->getCamera()->getName());
+
+	begin(evt.source);
+}
+
+void RenderProfiler::postViewportUpdate(const RenderTargetViewportEvent &evt) {
+	end(evt.source);
+}
+
+void RenderProfiler::preRenderTargetUpdate(const RenderTargetEvent &evt) {
+	if (evt.source != mWindow)
+		begin(evt.source);
+}
+
+void RenderProfiler::postRenderTargetUpdate(const RenderTargetEvent &evt) {
+	if (evt.source != mWindow)
+		end(evt.source);
+}
+
+void RenderProfiler::cameraPreRenderScene(Camera *cam) {
+	begin(cam);
+}
+
+void RenderProfiler::cameraPostRenderScene(Camera *cam) {
+	end(cam);
+}
+
+void RenderProfiler::setName(const void *object, const String &name) {
+	mObjectNames[object] = mNames.insert(name).first->c_str();
+}
+
+void RenderProfiler::begin(const void *object) {
+	mStarts[object] = Profiler::getSingleton().now();
+}
+
+void RenderProfiler::end(const void *object) {
+	std::map<const void*, const char*>::iterator name = mObjectNames.find(object);
+
+	if (name == mObjectNames.end())
+		return;
+
+	Profiler &profiler = Profiler::getSingleton();
+	unsigned long start = mStarts[object];
+	profiler.record(name->second, start, profiler.now() - start);
+}
+
+} /* namespace HMD */
@@ -0,0 +1,61 @@
+#ifndef __RenderProfiler_h_
+#define __RenderProfiler_h_
+
+#include <OgreRoot.h>
+#include <OgreCamera.h>
+#include <OgreRenderTargetListener.h>
+#include <OgreCompositorInstance.h>
+#include "Profiler.h"
+#include <set>
+
+namespace HMD {
+
+using namespace Ogre;
+
+/*
+ * Hooks the Profiler into the rendering: times each viewport update of the
+ * window, each scene render per eye camera and each compositor target.
+ */
+class RenderProfiler: public RenderTargetListener, public Camera::Listener {
+public:
+	RenderProfiler(RenderTarget *window);
+	~RenderProfiler();
+
+	void addCamera(Camera *camera);
+	void addCompositor(CompositorInstance *compositor);
+
+	// RenderTargetListener for the window and the compositor targets
+	void preViewportUpdate(const RenderTargetViewportEvent &evt);
+	void postViewportUpdate(const RenderTargetViewportEvent &evt);
+	void preRenderTargetUpdate(const RenderTargetEvent &evt);
+	void postRenderTargetUpdate(const RenderTargetEvent &evt);
+	// Camera::Listener
+	void cameraPreRenderScene(Camera *cam);
+	void cameraPostRenderScene(Camera *cam);
+
+private:
+	// Compositor targets are recreated on resize and have to be hooked again
+	class CompositorHook: public CompositorInstance::Listener {
+	public:
+		CompositorHook(RenderProfiler *profiler, CompositorInstance *compositor);
+		void notifyResourcesCreated(bool forResizeOnly);
+		CompositorInstance *compositor;
+	private:
+		RenderProfiler *mProfiler;
+	};
+
+	RenderTarget *mWindow;
+	std::vector<Camera*> mCameras;
+	std::vector<CompositorHook*> mCompositorHooks;
+	// Event names have to live as long as the profiler data, so they are never removed
+	std::set<String> mNames;
+	std::map<const void*, const char*> mObjectNames;
+	std::map<const void*, unsigned long> mStarts;
+
+	void setName(const void *object, const String &name);
+	void begin(const void *object);
+	void end(const void *object);
+};
+
+} /* namespace HMD */
+#endif // #ifndef __RenderProfiler_h_
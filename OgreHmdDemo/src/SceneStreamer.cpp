@@ -0,0 +1,203 @@
+#include "SceneStreamer.h"
+#include <OgreMaterialManager.h>
+#include <OgreMeshManager.h>
+#include <OgreSubMesh.h>
+#include <OgreTechnique.h>
+#include <boost/thread.hpp>
+#include "Profiler.h"
+
+namespace HMD {
+
+SceneStreamer::SceneStreamer(SceneManager *sceneMgr, LazyScriptLoader *scriptLoader) :
+		mSceneMgr(sceneMgr), mScriptLoader(scriptLoader),
+		mGroup(ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME),
+		mRequestCount(0), mCompletedCount(0), mInRequest(false) {
+}
+
+SceneStreamer::~SceneStreamer() {
+	ResourceBackgroundQueue &queue = ResourceBackgroundQueue::getSingleton();
+	std::set<Job*> jobs;
+
+	for (std::map<BackgroundProcessTicket, Request>::iterator it = mTickets.begin(); it != mTickets.end(); ++it) {
+		queue.abortRequest(it->first);
+		jobs.insert(it->second.job);
+	}
+
+	for (std::set<Job*>::iterator it = jobs.begin(); it != jobs.end(); ++it)
+		delete *it;
+}
+
+void SceneStreamer::addEntity(const String &name, const String &meshName, SceneNode *node,
+		const String &materialName, bool castShadows) {
+	Job *job = new Job();
+	job->name = name;
+	job->meshName = meshName;
+	job->materialName = materialName;
+	job->node = node;
+	job->castShadows = castShadows;
+	job->pending = 1;
+
+	// manual meshes are already there
+	MeshPtr mesh = MeshManager::getSingleton().getByName(meshName, mGroup);
+
+	if (!mesh.isNull() && mesh->isLoaded())
+		meshLoaded(job);
+	else
+		request(job, true, meshName);
+}
+
+void SceneStreamer::setSkyDome(const String &materialName, Real curvature, Real tiling) {
+	Job *job = new Job();
+	job->materialName = materialName;
+	job->node = 0;
+	job->curvature = curvature;
+	job->tiling = tiling;
+	job->pending = 1;
+
+	prepareTextures(job, materialName);
+
+	if (--job->pending == 0)
+		finish(job);
+}
+
+Real SceneStreamer::getProgress() const {
+	return mRequestCount == 0 ? 1 : Real(mCompletedCount) / mRequestCount;
+}
+
+void SceneStreamer::waitUntilLoaded(void) {
+	while (isLoading()) {
+		Root::getSingleton().getWorkQueue()->processResponses();
+		boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+	}
+}
+
+void SceneStreamer::request(Job *job, bool mesh, const String &name) {
+	ResourceBackgroundQueue &queue = ResourceBackgroundQueue::getSingleton();
+	BackgroundProcessTicket ticket;
+
+	mCurrentRequest.job = job;
+	mCurrentRequest.mesh = mesh;
+	mInRequest = true;
+	mRequestCount++;
+
+	// Meshes are loaded completely, textures only prepared: reading and decoding
+	// happens in the background, the upload when the material is first used
+	if (mesh)
+		ticket = queue.load("Mesh", name, mGroup, false, 0, 0, this);
+	else
+		ticket = queue.prepare("Texture", name, mGroup, false, 0, 0, this);
+
+	// still set if the request did not complete synchronously
+	if (mInRequest)
+		mTickets[ticket] = mCurrentRequest;
+
+	mInRequest = false;
+}
+
+void SceneStreamer::operationCompleted(BackgroundProcessTicket ticket, const BackgroundProcessResult &result) {
+	Request request;
+	std::map<BackgroundProcessTicket, Request>::iterator it = mTickets.find(ticket);
+
+	if (it != mTickets.end()) {
+		request = it->second;
+		mTickets.erase(it);
+	} else if (mInRequest) {
+		request = mCurrentRequest;
+		mInRequest = false;
+	} else {
+		return;
+	}
+
+	mCompletedCount++;
+
+	if (result.error) {
+		LogManager::getSingleton().logMessage("SceneStreamer: " + result.message, LML_CRITICAL);
+
+		// without its mesh nothing else of the job has been requested yet
+		if (request.mesh) {
+			delete request.job;
+			return;
+		}
+	}
+
+	completed(request);
+}
+
+void SceneStreamer::completed(const Request &request) {
+	Job *job = request.job;
+
+	if (request.mesh)
+		meshLoaded(job);
+	else if (--job->pending == 0)
+		finish(job);
+}
+
+void SceneStreamer::meshLoaded(Job *job) {
+	MeshPtr mesh = MeshManager::getSingleton().getByName(job->meshName, mGroup);
+
+	if (job->materialName.empty() && !mesh.isNull()) {
+		for (unsigned short i = 0; i < mesh->getNumSubMeshes(); i++)
+			prepareTextures(job, mesh->getSubMesh(i)->getMaterialName());
+	} else {
+		prepareTextures(job, job->materialName);
+	}
+
+	if (--job->pending == 0)
+		finish(job);
+}
+
+void SceneStreamer::prepareTextures(Job *job, const String &materialName) {
+	mScriptLoader->ensureMaterial(materialName);
+	MaterialPtr material = MaterialManager::getSingleton().getByName(materialName);
+
+	if (material.isNull())
+		return;
+
+	Material::TechniqueIterator techniques = material->getTechniqueIterator();
+
+	while (techniques.hasMoreElements()) {
+		Technique::PassIterator passes = techniques.getNext()->getPassIterator();
+
+		while (passes.hasMoreElements()) {
+			Pass::TextureUnitStateIterator units = passes.getNext()->getTextureUnitStateIterator();
+
+			while (units.hasMoreElements()) {
+				TextureUnitState *unit = units.getNext();
+
+				// cube maps and render textures are left to the material
+				if (unit->isCubic() || unit->getContentType() != TextureUnitState::CONTENT_NAMED)
+					continue;
+
+				for (unsigned int frame = 0; frame < unit->getNumFrames(); frame++) {
+					const String &texture = unit->getFrameTextureName(frame);
+
+					if (!texture.empty() && mRequestedTextures.insert(texture).second) {
+						job->pending++;
+						request(job, false, texture);
+					}
+				}
+			}
+		}
+	}
+}
+
+void SceneStreamer::finish(Job *job) {
+	HMD_PROFILE("streaming/createEntity");
+
+	if (job->node) {
+		Entity *entity = mSceneMgr->createEntity(job->name, job->meshName);
+
+		if (!job->materialName.empty())
+			entity->setMaterialName(job->materialName);
+
+		entity->setCastShadows(job->castShadows);
+		job->node->attachObject(entity);
+	} else {
+		mSceneMgr->setSkyDome(true, job->materialName, job->curvature, job->tiling);
+	}
+
+	Profiler::getSingleton().setCounter("streamingProgress", getProgress());
+	delete job;
+}
+
+} /* namespace HMD */
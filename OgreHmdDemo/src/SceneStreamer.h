@@ -0,0 +1,77 @@
+#ifndef __SceneStreamer_h_
+#define __SceneStreamer_h_
+
+#include <OgreRoot.h>
+#include <OgreSceneManager.h>
+#include <OgreResourceBackgroundQueue.h>
+#include "LazyScriptLoader.h"
+#include <set>
+
+namespace HMD {
+
+using namespace Ogre;
+
+/*
+ * Streams scene content in through the ResourceBackgroundQueue: meshes are
+ * loaded and the textures of their materials are prepared (read and decoded)
+ * on the work queue threads. An entity is only created once all of its
+ * resources are ready, so its creation merely uploads to the GPU.
+ * Completions are delivered on the main thread while frames are rendered.
+ */
+class SceneStreamer: public ResourceBackgroundQueue::Listener {
+public:
+	SceneStreamer(SceneManager *sceneMgr, LazyScriptLoader *scriptLoader);
+	virtual ~SceneStreamer();
+
+	// Creates the entity and attaches it to the node once mesh and textures are ready
+	void addEntity(const String &name, const String &meshName, SceneNode *node,
+			const String &materialName = StringUtil::BLANK, bool castShadows = true);
+	// Enables the sky dome once the textures of its material are ready
+	void setSkyDome(const String &materialName, Real curvature, Real tiling);
+
+	bool isLoading() const { return !mTickets.empty() || mInRequest; }
+	// Fraction of the requested resources which are ready
+	Real getProgress() const;
+	// Blocks until everything is loaded, for the non-interactive modes
+	void waitUntilLoaded(void);
+
+	// ResourceBackgroundQueue::Listener
+	void operationCompleted(BackgroundProcessTicket ticket, const BackgroundProcessResult &result);
+
+private:
+	struct Job {
+		String name;
+		String meshName;
+		String materialName;
+		SceneNode *node;
+		bool castShadows;
+		Real curvature;
+		Real tiling;
+		size_t pending;
+	};
+
+	struct Request {
+		Job *job;
+		bool mesh;
+	};
+
+	SceneManager *mSceneMgr;
+	LazyScriptLoader *mScriptLoader;
+	String mGroup;
+	std::map<BackgroundProcessTicket, Request> mTickets;
+	std::set<String> mRequestedTextures;
+	size_t mRequestCount;
+	size_t mCompletedCount;
+	// A queue without worker threads completes requests synchronously
+	bool mInRequest;
+	Request mCurrentRequest;
+
+	void request(Job *job, bool mesh, const String &name);
+	void meshLoaded(Job *job);
+	void prepareTextures(Job *job, const String &materialName);
+	void completed(const Request &request);
+	void finish(Job *job);
+};
+
+} /* namespace HMD */
+#endif // #ifndef __SceneStreamer_h_
@@ -0,0 +1,134 @@
+#include "ShaderCache.h"
+#include <OgreGpuProgramManager.h>
+#include <OgreMaterialManager.h>
+#include <OgreResourceGroupManager.h>
+#include <OgreRenderSystemCapabilities.h>
+#include <OgreArchiveManager.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+namespace HMD {
+
+// Everything that ends up in a compiled program, materials included since
+// they carry the compile arguments and preprocessor defines
+static const char *SOURCE_PATTERNS[] = { "*.cg", "*.hlsl", "*.glsl", "*.vert", "*.frag",
+		"*.program", "*.material", 0 };
+
+static uint32 fnv1a(uint32 hash, const String &data) {
+	for (size_t i = 0; i < data.size(); i++) {
+		hash ^= (uchar) data[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+ShaderCache::ShaderCache() :
+		mWarm(false) {
+}
+
+uint32 ShaderCache::hashSources(RenderSystem *renderSystem) {
+	ResourceGroupManager &rgm = ResourceGroupManager::getSingleton();
+	StringVector groups = rgm.getResourceGroups();
+	// Cg picks the program profiles by the capabilities of the GPU
+	const RenderSystemCapabilities *caps = renderSystem->getCapabilities();
+	uint32 hash = fnv1a(FNV_OFFSET, renderSystem->getName() + " " + caps->getDeviceName() + " "
+			+ caps->getDriverVersion().toString() + " " + StringConverter::toString(OGRE_VERSION));
+
+	// Name, size and modification time identify a changed source without
+	// reading every file at startup
+	for (size_t g = 0; g < groups.size(); g++) {
+		for (const char **pattern = SOURCE_PATTERNS; *pattern; pattern++) {
+			FileInfoListPtr files = rgm.findResourceFileInfo(groups[g], *pattern);
+			std::vector<String> entries;
+
+			for (FileInfoList::iterator it = files->begin(); it != files->end(); ++it) {
+				entries.push_back(it->filename + " " + StringConverter::toString(it->uncompressedSize) + " "
+						+ StringConverter::toString((unsigned long) it->archive->getModifiedTime(it->filename)));
+			}
+
+			std::sort(entries.begin(), entries.end());
+
+			for (size_t i = 0; i < entries.size(); i++)
+				hash = fnv1a(hash, entries[i]);
+		}
+	}
+
+	return hash;
+}
+
+void ShaderCache::load(void) {
+	GpuProgramManager &gpm = GpuProgramManager::getSingleton();
+	std::ostringstream fileName;
+
+	fileName << "shadercache_" << std::hex << std::setw(8) << std::setfill('0')
+			<< hashSources(Root::getSingleton().getRenderSystem()) << ".bin";
+	mFileName = fileName.str();
+
+	gpm.setSaveMicrocodesToCache(true);
+
+	std::ifstream *in = OGRE_NEW_T(std::ifstream, MEMCATEGORY_GENERAL)(mFileName.c_str(), std::ios::binary);
+
+	if (!*in) {
+		OGRE_DELETE_T(in, basic_ifstream, MEMCATEGORY_GENERAL);
+		LogManager::getSingleton().logMessage("Shader cache: no " + mFileName + ", compiling all programs (cold)");
+		removeStale();
+		return;
+	}
+
+	DataStreamPtr stream(OGRE_NEW FileStreamDataStream(mFileName, in, true));
+	gpm.loadMicrocodeCache(stream);
+	mWarm = true;
+	LogManager::getSingleton().logMessage("Shader cache: loaded " + mFileName + " (warm)");
+}
+
+void ShaderCache::removeStale(void) {
+	// The caches of earlier sources or drivers will never match again
+	Archive *dir = ArchiveManager::getSingleton().load(".", "FileSystem");
+	StringVectorPtr stale = dir->find("shadercache_*.bin", false, false);
+
+	for (size_t i = 0; i < stale->size(); i++) {
+		if ((*stale)[i] != mFileName && std::remove((*stale)[i].c_str()) == 0)
+			LogManager::getSingleton().logMessage("Shader cache: removed stale " + (*stale)[i]);
+	}
+
+	ArchiveManager::getSingleton().unload(dir);
+}
+
+void ShaderCache::warmUp(void) {
+	ResourceManager::ResourceMapIterator it = MaterialManager::getSingleton().getResourceIterator();
+
+	// Loading a material compiles the programs of its supported techniques
+	while (it.hasMoreElements()) {
+		ResourcePtr material = it.getNext();
+
+		try {
+			material->load();
+		} catch (Exception &e) {
+			LogManager::getSingleton().logMessage("Shader cache: skipping " + material->getName()
+					+ ": " + e.getDescription());
+		}
+	}
+}
+
+void ShaderCache::save(void) {
+	GpuProgramManager &gpm = GpuProgramManager::getSingleton();
+
+	if (mFileName.empty() || !gpm.isCacheDirty())
+		return;
+
+	std::fstream *out = OGRE_NEW_T(std::fstream, MEMCATEGORY_GENERAL)(mFileName.c_str(),
+			std::ios::out | std::ios::binary | std::ios::trunc);
+	DataStreamPtr stream(OGRE_NEW FileStreamDataStream(mFileName, out, true));
+
+	gpm.saveMicrocodeCache(stream);
+	LogManager::getSingleton().logMessage("Shader cache: saved " + mFileName);
+}
+
+} /* namespace HMD */
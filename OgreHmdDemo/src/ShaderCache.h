@@ -0,0 +1,45 @@
+#ifndef __ShaderCache_h_
+#define __ShaderCache_h_
+
+#include <OgreRoot.h>
+
+namespace HMD {
+
+using namespace Ogre;
+
+/*
+ * On-disk cache of the compiled GPU programs (Ogre's microcode cache). The
+ * cache file is keyed by a hash over the render system, the GPU and driver
+ * and the name, size and modification time of all program and material
+ * sources of the resource locations, so editing a shader or switching the
+ * render system never picks up stale microcode. Caches of other hashes are
+ * deleted.
+ */
+class ShaderCache {
+public:
+	ShaderCache();
+
+	// Enables the microcode cache and loads the file matching the current sources.
+	// Call after the resource locations are added and the render system is set
+	void load(void);
+	// Compiles the programs of all materials, so that the cache is complete
+	void warmUp(void);
+	// Writes the cache if programs were compiled since it was loaded
+	void save(void);
+
+	// Whether a matching cache existed on startup
+	bool isWarm() const { return mWarm; }
+	const String& getFileName() const { return mFileName; }
+
+private:
+	String mFileName;
+	bool mWarm;
+
+	// Deletes the cache files of other hashes in the working directory
+	void removeStale(void);
+
+	static uint32 hashSources(RenderSystem *renderSystem);
+};
+
+} /* namespace HMD */
+#endif // #ifndef __ShaderCache_h_
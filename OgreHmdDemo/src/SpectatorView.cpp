@@ -0,0 +1,223 @@
+#include "SpectatorView.h"
+#include "Profiler.h"
+#include <OgreRenderWindow.h>
+#include <OgreRenderTexture.h>
+#include <OgreHardwarePixelBuffer.h>
+#include <OgreMaterialManager.h>
+#include <OgreTextureManager.h>
+#include <OgreTechnique.h>
+#include <OgreSceneManager.h>
+#include <algorithm>
+
+#ifdef HMD_GL_TIMER_QUERY
+#	if OGRE_PLATFORM == OGRE_PLATFORM_APPLE
+#		include <OpenGL/gl3.h>
+#	else
+#		define GL_GLEXT_PROTOTYPES
+#		include <GL/gl.h>
+#		include <GL/glext.h>
+#	endif
+#endif
+
+#define SPECTATOR_NAME "Spectator"
+#define SOURCE_TEXTURE "rt0"
+
+namespace HMD {
+
+SpectatorView::SpectatorView(const std::vector<CompositorInstance*> &leftCompositors, const Config &config) :
+		mLeftCompositors(leftCompositors), mConfig(config), mEnabled(false), mTextureUnit(0),
+		mWindow(0), mTarget(0), mLastUpdate(0), mGpuTimer(false), mQuery(0), mQueryPending(false) {
+	// A scene of its own with a single full screen quad
+	mSceneMgr = Root::getSingleton().createSceneManager(ST_GENERIC, SPECTATOR_NAME);
+	mSceneMgr->addRenderQueueListener(this);
+	mCamera = mSceneMgr->createCamera(SPECTATOR_NAME);
+
+	mMaterial = MaterialManager::getSingleton().create(SPECTATOR_NAME, ResourceGroupManager::INTERNAL_RESOURCE_GROUP_NAME);
+	Pass *pass = mMaterial->getTechnique(0)->getPass(0);
+	pass->setLightingEnabled(false);
+	pass->setDepthCheckEnabled(false);
+	pass->setDepthWriteEnabled(false);
+	pass->setCullingMode(CULL_NONE);
+	mTextureUnit = pass->createTextureUnitState();
+	mTextureUnit->setTextureAddressingMode(TextureUnitState::TAM_CLAMP);
+	mTextureUnit->setTextureFiltering(TFO_BILINEAR);
+
+	mQuad = OGRE_NEW Rectangle2D(true);
+	mQuad->setBoundingBox(AxisAlignedBox::BOX_INFINITE);
+	mQuad->setMaterial(SPECTATOR_NAME);
+	mSceneMgr->getRootSceneNode()->attachObject(mQuad);
+}
+
+SpectatorView::~SpectatorView() {
+	setEnabled(false);
+	mSceneMgr->getRootSceneNode()->detachObject(mQuad);
+	OGRE_DELETE mQuad;
+	MaterialManager::getSingleton().remove(mMaterial->getHandle());
+	Root::getSingleton().destroySceneManager(mSceneMgr);
+}
+
+void SpectatorView::setEnabled(bool enabled) {
+	if (enabled == mEnabled)
+		return;
+
+	mEnabled = enabled;
+
+	if (enabled)
+		createTarget();
+	else
+		destroyTarget();
+}
+
+void SpectatorView::createTarget() {
+	if (mConfig.offscreen) {
+		mTexture = TextureManager::getSingleton().createManual(SPECTATOR_NAME,
+				ResourceGroupManager::INTERNAL_RESOURCE_GROUP_NAME, TEX_TYPE_2D,
+				mConfig.width, mConfig.height, 0, PF_R8G8B8, TU_RENDERTARGET);
+		mTarget = mTexture->getBuffer()->getRenderTarget();
+	} else {
+		// a spectator window must never hold the render thread at its swap
+		NameValuePairList params;
+		params["vsync"] = "false";
+		params["border"] = "fixed";
+		mWindow = Root::getSingleton().createRenderWindow(SPECTATOR_NAME, mConfig.width, mConfig.height, false, &params);
+		mTarget = mWindow;
+	}
+
+	mTarget->setAutoUpdated(false);
+	Viewport *viewport = mTarget->addViewport(mCamera);
+	viewport->setBackgroundColour(ColourValue::Black);
+	viewport->setOverlaysEnabled(false);
+	mLastUpdate = 0;
+	mGpuTimer = Root::getSingleton().getRenderSystem()->getName() == "OpenGL Rendering Subsystem";
+
+	LogManager::getSingleton().logMessage("Spectator view " + StringConverter::toString(mConfig.width) + "x"
+			+ StringConverter::toString(mConfig.height) + " at " + StringConverter::toString(mConfig.rate) + " Hz"
+			+ (mConfig.offscreen ? ", offscreen" : ""));
+}
+
+void SpectatorView::destroyTarget() {
+	// the query belongs to the context of the target, a window takes it along
+#ifdef HMD_GL_TIMER_QUERY
+	if (mQuery && !mWindow)
+		glDeleteQueries(1, &mQuery);
+#endif
+	mQuery = 0;
+	mQueryPending = false;
+
+	if (mWindow) {
+		Root::getSingleton().getRenderSystem()->destroyRenderWindow(SPECTATOR_NAME);
+		mWindow = 0;
+	}
+
+	if (!mTexture.isNull()) {
+		TextureManager::getSingleton().remove(mTexture->getHandle());
+		mTexture.setNull();
+	}
+
+	mTarget = 0;
+}
+
+bool SpectatorView::bindSource() {
+	CompositorInstance *source = 0;
+
+	for (size_t i = 0; i < mLeftCompositors.size() && !source; i++) {
+		if (mLeftCompositors[i]->getEnabled())
+			source = mLeftCompositors[i];
+	}
+
+	if (!source)
+		return false;
+
+	// the compositor recreates its textures on resize, look the name up each time
+	String name = source->getTextureInstanceName(SOURCE_TEXTURE, 0);
+
+	if (name != mTextureUnit->getTextureName()) {
+		TexturePtr texture = TextureManager::getSingleton().getByName(name);
+
+		if (texture.isNull())
+			return false;
+
+		mTextureUnit->setTextureName(name);
+
+		Real sourceAspect = Real(texture->getWidth()) / texture->getHeight();
+		Real targetAspect = Real(mConfig.width) / mConfig.height;
+		Real x = std::min(sourceAspect / targetAspect, Real(1));
+		Real y = std::min(targetAspect / sourceAspect, Real(1));
+		mQuad->setCorners(-x, y, x, -y);
+	}
+
+	return true;
+}
+
+void SpectatorView::frameEnded() {
+	if (!mEnabled)
+		return;
+
+	if (mWindow && mWindow->isClosed()) {
+		setEnabled(false);
+		return;
+	}
+
+	Profiler &profiler = Profiler::getSingleton();
+	unsigned long now = profiler.now();
+
+	if (now - mLastUpdate < 1000000 / mConfig.rate || !bindSource())
+		return;
+
+	mLastUpdate = now;
+
+	{
+		HMD_PROFILE("spectator");
+		mTarget->update(false);
+
+		if (mWindow)
+			mWindow->swapBuffers(false);
+	}
+
+	profiler.setCounter("spectatorCpuMs", (profiler.now() - now) / 1000.0);
+}
+
+void SpectatorView::preRenderQueues() {
+	// runs in the context of the spectator target
+#ifdef HMD_GL_TIMER_QUERY
+	if (!mGpuTimer)
+		return;
+
+	if (!mQuery)
+		glGenQueries(1, &mQuery);
+
+	readGpuTime();
+
+	if (!mQueryPending)
+		glBeginQuery(GL_TIME_ELAPSED, mQuery);
+#endif
+}
+
+void SpectatorView::postRenderQueues() {
+#ifdef HMD_GL_TIMER_QUERY
+	if (mQuery && !mQueryPending) {
+		glEndQuery(GL_TIME_ELAPSED);
+		mQueryPending = true;
+	}
+#endif
+}
+
+void SpectatorView::readGpuTime() {
+#ifdef HMD_GL_TIMER_QUERY
+	if (!mQueryPending)
+		return;
+
+	// a result not available yet is skipped, one update is measured at a time
+	GLint available = 0;
+	glGetQueryObjectiv(mQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+
+	if (available) {
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(mQuery, GL_QUERY_RESULT, &elapsed);
+		Profiler::getSingleton().setCounter("spectatorGpuMs", elapsed / 1000000.0);
+		mQueryPending = false;
+	}
+#endif
+}
+
+} /* namespace HMD */
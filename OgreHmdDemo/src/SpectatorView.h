@@ -0,0 +1,75 @@
+#ifndef __SpectatorView_h_
+#define __SpectatorView_h_
+
+#include <OgreRoot.h>
+#include <OgreCompositorInstance.h>
+#include <OgreRenderQueueListener.h>
+#include <OgreRectangle2D.h>
+#include <OgreTextureUnitState.h>
+#include <vector>
+
+namespace HMD {
+
+using namespace Ogre;
+
+/*
+ * Undistorted mono view for people watching a session: shows the left eye
+ * scene texture (rt0 of the left eye compositor, before the lens warp) in a
+ * second window or an offscreen texture, at a lower resolution and rate.
+ * It is updated after the HMD frame has been swapped, its window does not
+ * wait for the vertical blank and its GPU time is measured with a timer
+ * query that is only read once available, so the HMD frame never waits for
+ * it. Counters: spectatorCpuMs, spectatorGpuMs (GL only).
+ */
+class SpectatorView: public RenderQueueListener {
+public:
+	struct Config {
+		unsigned int width;
+		unsigned int height;
+		Real rate;
+		bool offscreen;
+	};
+
+	// Takes the rt0 of whichever of the given left eye compositors is enabled
+	SpectatorView(const std::vector<CompositorInstance*> &leftCompositors, const Config &config);
+	virtual ~SpectatorView();
+
+	void setEnabled(bool enabled);
+	bool isEnabled() const { return mEnabled; }
+	// The offscreen target, 0 with a window
+	TexturePtr getTexture() const { return mTexture; }
+
+	// Call after the HMD frame was swapped, updates the view when it is due
+	void frameEnded(void);
+
+	// RenderQueueListener, brackets the GPU work of the view
+	void preRenderQueues(void);
+	void postRenderQueues(void);
+
+private:
+	std::vector<CompositorInstance*> mLeftCompositors;
+	Config mConfig;
+	bool mEnabled;
+	SceneManager *mSceneMgr;
+	Camera *mCamera;
+	Rectangle2D *mQuad;
+	MaterialPtr mMaterial;
+	TextureUnitState *mTextureUnit;
+	RenderWindow *mWindow;
+	TexturePtr mTexture;
+	RenderTarget *mTarget;
+	unsigned long mLastUpdate;
+	// GL timer query, created in the context of the target
+	bool mGpuTimer;
+	unsigned int mQuery;
+	bool mQueryPending;
+
+	void createTarget(void);
+	void destroyTarget(void);
+	// Points the quad at the current rt0, letterboxed to its aspect ratio
+	bool bindSource(void);
+	void readGpuTime(void);
+};
+
+} /* namespace HMD */
+#endif // #ifndef __SpectatorView_h_
@@ -0,0 +1,122 @@
+#include "StereoReprojection.h"
+#include <OgreCompositorManager.h>
+#include <OgreCompositorChain.h>
+#include "Profiler.h"
+
+#define COMPOSITOR_LEFT "OculusLeft"
+#define COMPOSITOR_RIGHT "OculusRight"
+#define SCHEME_DEPTH "HmdDepth"
+#define PASS_REPROJECT 1
+#define PASS_HOLE_MASK 2
+#define HOLE_REPORT_INTERVAL 60
+
+namespace HMD {
+
+StereoReprojection::StereoReprojection(HmdConfig *hmdCfg, CompositorInstance *leftComp, CompositorInstance *rightComp) :
+		mHmdCfg(hmdCfg), mLeftViewport(leftComp->getChain()->getViewport()),
+		mRightViewport(rightComp->getChain()->getViewport()),
+		mLeftComp(leftComp), mRightComp(rightComp), mHoleTarget(0), mHoleQuery(0),
+		mEnabled(false), mQueryIssued(false), mHoleFraction(0), mFrameCount(0) {
+	mRightComp->addListener(this);
+
+	mDepthMaterial = MaterialManager::getSingleton().getByName("Ogre/Compositor/Oculus/Depth");
+	mDepthMaterial->load();
+	MaterialManager::getSingleton().addListener(this, SCHEME_DEPTH);
+
+	mHoleQuery = Root::getSingleton().getRenderSystem()->createHardwareOcclusionQuery();
+}
+
+StereoReprojection::~StereoReprojection() {
+	if (mHoleTarget)
+		mHoleTarget->removeListener(this);
+
+	mRightComp->removeListener(this);
+	MaterialManager::getSingleton().removeListener(this, SCHEME_DEPTH);
+	Root::getSingleton().getRenderSystem()->destroyHardwareOcclusionQuery(mHoleQuery);
+}
+
+void StereoReprojection::setEnabled(bool enabled) {
+	CompositorManager &compositorMngr = CompositorManager::getSingleton();
+
+	mEnabled = enabled;
+
+	// The left compositor owns the global textures the right one refers to,
+	// so it has to be enabled first and disabled last
+	if (enabled) {
+		compositorMngr.setCompositorEnabled(mLeftViewport, COMPOSITOR_LEFT, false);
+		mLeftComp->setEnabled(true);
+		compositorMngr.setCompositorEnabled(mRightViewport, COMPOSITOR_RIGHT, false);
+		mRightComp->setEnabled(true);
+	} else {
+		mRightComp->setEnabled(false);
+		compositorMngr.setCompositorEnabled(mRightViewport, COMPOSITOR_RIGHT, true);
+		mLeftComp->setEnabled(false);
+		compositorMngr.setCompositorEnabled(mLeftViewport, COMPOSITOR_LEFT, true);
+		mHoleFraction = 0;
+	}
+
+	LogManager::getSingleton().logMessage(String("Stereo reprojection ") + (enabled ? "enabled" : "disabled"));
+}
+
+void StereoReprojection::notifyMaterialRender(uint32 passId, MaterialPtr &mat) {
+	// Every frame rather than once at setup, the IPD may change while running
+	if (passId == PASS_REPROJECT || passId == PASS_HOLE_MASK)
+		updateReprojectParams(mat->getBestTechnique()->getPass(0)->getFragmentProgramParameters());
+}
+
+void StereoReprojection::notifyResourcesCreated(bool forResizeOnly) {
+	if (mHoleTarget)
+		mHoleTarget->removeListener(this);
+
+	mHoleTarget = mRightComp->getRenderTarget("holes");
+	mHoleTarget->addListener(this);
+	mQueryIssued = false;
+}
+
+void StereoReprojection::preRenderTargetUpdate(const RenderTargetEvent &evt) {
+	collectHoleQuery();
+
+	if (!mQueryIssued)
+		mHoleQuery->beginOcclusionQuery();
+}
+
+void StereoReprojection::postRenderTargetUpdate(const RenderTargetEvent &evt) {
+	if (!mQueryIssued) {
+		mHoleQuery->endOcclusionQuery();
+		mQueryIssued = true;
+	}
+}
+
+Technique* StereoReprojection::handleSchemeNotFound(unsigned short schemeIndex, const String &schemeName,
+		Material *originalMaterial, unsigned short lodIndex, const Renderable *rend) {
+	return mDepthMaterial->getTechnique(0);
+}
+
+void StereoReprojection::updateReprojectParams(GpuProgramParametersSharedPtr params) {
+	// Both eyes share the projection apart from the centre offset, so a point at
+	// depth d moves by P00 * ipd / d in NDC (half of that in texture space)
+	Real p00 = mLeftViewport->getCamera()->getProjectionMatrix()[0][0];
+	float reproject[2] = { p00 * mHmdCfg->interPupillaryDistance / 2.0f, mHmdCfg->projectionCenterOffset };
+
+	// ReprojectParam is a float2, one element of two floats
+	params->setNamedConstant("ReprojectParam", reproject, 1, 2);
+}
+
+void StereoReprojection::collectHoleQuery() {
+	// Never stall the frame for the result, it is picked up when it is ready
+	if (!mQueryIssued || mHoleQuery->isStillOutstanding())
+		return;
+
+	unsigned int holePixels = 0;
+	mHoleQuery->pullOcclusionQuery(&holePixels);
+	mQueryIssued = false;
+
+	mHoleFraction = Real(holePixels) / Real(mHoleTarget->getWidth() * mHoleTarget->getHeight());
+	Profiler::getSingleton().setCounter("reprojectionHoleFraction", mHoleFraction);
+
+	if (++mFrameCount % HOLE_REPORT_INTERVAL == 0)
+		LogManager::getSingleton().logMessage("Stereo reprojection hole fraction: "
+				+ StringConverter::toString(mHoleFraction));
+}
+
+} /* namespace HMD */
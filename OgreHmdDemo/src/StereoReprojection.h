@@ -0,0 +1,62 @@
+#ifndef __StereoReprojection_h_
+#define __StereoReprojection_h_
+
+#include <OgreRoot.h>
+#include <OgreCompositorInstance.h>
+#include <OgreRenderTargetListener.h>
+#include <OgreHardwareOcclusionQuery.h>
+#include <OgreMaterialManager.h>
+#include "HmdConfig.h"
+
+namespace HMD {
+
+using namespace Ogre;
+
+/*
+ * Renders the left eye only and synthesizes the right eye by reprojecting the
+ * left colour and depth buffer by the IPD offset. Disoccluded pixels are filled
+ * with the background. The fraction of hole pixels is measured each frame with
+ * an occlusion query to decide per scene whether the mode pays off.
+ */
+class StereoReprojection: public CompositorInstance::Listener,
+		public RenderTargetListener,
+		public MaterialManager::Listener {
+public:
+	StereoReprojection(HmdConfig *hmdCfg, CompositorInstance *leftComp, CompositorInstance *rightComp);
+	virtual ~StereoReprojection();
+
+	void setEnabled(bool enabled);
+	bool isEnabled() const { return mEnabled; }
+	// Fraction of disoccluded right eye pixels of the last measured frame
+	Real getHoleFraction() const { return mHoleFraction; }
+
+	// CompositorInstance::Listener
+	void notifyMaterialRender(uint32 passId, MaterialPtr &mat);
+	void notifyResourcesCreated(bool forResizeOnly);
+	// RenderTargetListener for the hole mask target
+	void preRenderTargetUpdate(const RenderTargetEvent &evt);
+	void postRenderTargetUpdate(const RenderTargetEvent &evt);
+	// MaterialManager::Listener providing the depth technique
+	Technique* handleSchemeNotFound(unsigned short schemeIndex, const String &schemeName,
+			Material *originalMaterial, unsigned short lodIndex, const Renderable *rend);
+
+private:
+	HmdConfig *mHmdCfg;
+	Viewport *mLeftViewport;
+	Viewport *mRightViewport;
+	CompositorInstance *mLeftComp;
+	CompositorInstance *mRightComp;
+	RenderTarget *mHoleTarget;
+	HardwareOcclusionQuery *mHoleQuery;
+	MaterialPtr mDepthMaterial;
+	bool mEnabled;
+	bool mQueryIssued;
+	Real mHoleFraction;
+	unsigned long mFrameCount;
+
+	void updateReprojectParams(GpuProgramParametersSharedPtr params);
+	void collectHoleQuery(void);
+};
+
+} /* namespace HMD */
+#endif // #ifndef __StereoReprojection_h_
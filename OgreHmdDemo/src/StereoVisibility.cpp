@@ -0,0 +1,145 @@
+#include "StereoVisibility.h"
+#include "Profiler.h"
+#include <OgreLodStrategyManager.h>
+#include <OgreSceneManager.h>
+
+#define CENTRE_CAMERA "CentreCamera"
+#define CULLING_FRUSTUM "CullingFrustum"
+#define FOVY 110
+#define FAR_CLIP 10000
+
+namespace HMD {
+
+SharedLodStrategy::SharedLodStrategy(DistanceLodStrategy *distance) :
+		LodStrategy(distance->getName()), mDistance(distance), mLodCamera(0), mEvaluations(0) {
+}
+
+SharedLodStrategy::~SharedLodStrategy() {
+	OGRE_DELETE mDistance;
+}
+
+Real SharedLodStrategy::getBaseValue() const {
+	return mDistance->getBaseValue();
+}
+
+Real SharedLodStrategy::transformBias(Real factor) const {
+	return mDistance->transformBias(factor);
+}
+
+Real SharedLodStrategy::transformUserValue(Real userValue) const {
+	return mDistance->transformUserValue(userValue);
+}
+
+ushort SharedLodStrategy::getIndex(Real value, const Mesh::MeshLodUsageList &meshLodUsageList) const {
+	return mDistance->getIndex(value, meshLodUsageList);
+}
+
+ushort SharedLodStrategy::getIndex(Real value, const Material::LodValueList &materialLodValueList) const {
+	return mDistance->getIndex(value, materialLodValueList);
+}
+
+void SharedLodStrategy::sort(Mesh::MeshLodUsageList &meshLodUsageList) const {
+	mDistance->sort(meshLodUsageList);
+}
+
+bool SharedLodStrategy::isSorted(const Mesh::LodValueList &values) const {
+	return mDistance->isSorted(values);
+}
+
+Real SharedLodStrategy::getValueImpl(const MovableObject *movableObject, const Camera *camera) const {
+	// shadow and other passes bring their own camera
+	if (camera == mLodCamera)
+		mEvaluations++;
+
+	// the camera passed is the LOD camera, which is its own LOD camera
+	return mDistance->getValue(movableObject, camera);
+}
+
+SharedCullingFrustum::SharedCullingFrustum(const String &name) :
+		Frustum(name), mTests(0) {
+}
+
+bool SharedCullingFrustum::isVisible(const AxisAlignedBox &bound, FrustumPlane *culledBy) const {
+	mTests++;
+	return Frustum::isVisible(bound, culledBy);
+}
+
+void StereoVisibility::installSharedLodStrategy() {
+	LodStrategyManager &manager = LodStrategyManager::getSingleton();
+
+	if (dynamic_cast<SharedLodStrategy*>(manager.getStrategy("Distance")))
+		return;
+
+	// Unregistered only, the shared strategy keeps and finally deletes it
+	DistanceLodStrategy *distance = static_cast<DistanceLodStrategy*>(manager.removeStrategy("Distance"));
+
+	SharedLodStrategy *shared = OGRE_NEW SharedLodStrategy(distance);
+	manager.addStrategy(shared);
+	manager.setDefaultStrategy(shared);
+}
+
+StereoVisibility::StereoVisibility(SceneManager *sceneMgr, SceneNode *cameraNode, const HmdConfig &hmdCfg) :
+		mSceneMgr(sceneMgr), mHmdCfg(hmdCfg),
+		mLastLodEvaluations(0), mLastTests(0) {
+	installSharedLodStrategy();
+
+	mLodCamera = mSceneMgr->createCamera(CENTRE_CAMERA);
+	mLodCamera->lookAt(Vector3(0, 0, -300));
+	mLodCamera->setNearClipDistance(mHmdCfg.eyeToScreenDistance);
+	mLodCamera->setFarClipDistance(FAR_CLIP);
+	mLodCamera->setFOVy(Radian(Degree(FOVY)));
+	cameraNode->attachObject(mLodCamera);
+	static_cast<SharedLodStrategy*>(LodStrategyManager::getSingleton().getStrategy("Distance"))->setLodCamera(mLodCamera);
+
+	mCullingFrustum = OGRE_NEW SharedCullingFrustum(CULLING_FRUSTUM);
+	mCullingFrustum->setNearClipDistance(mHmdCfg.eyeToScreenDistance);
+	mCullingFrustum->setFOVy(Radian(Degree(FOVY)));
+	mCullingNode = cameraNode->createChildSceneNode();
+	mCullingNode->attachObject(mCullingFrustum);
+
+	setAspectRatio(1);
+}
+
+StereoVisibility::~StereoVisibility() {
+	mCullingNode->detachObject(mCullingFrustum);
+	OGRE_DELETE mCullingFrustum;
+}
+
+void StereoVisibility::attach(Camera *eye) {
+	eye->setLodCamera(mLodCamera);
+	eye->setCullingFrustum(mCullingFrustum);
+}
+
+void StereoVisibility::setAspectRatio(Real aspectRatio) {
+	mLodCamera->setAspectRatio(aspectRatio);
+
+	// The projection centre offset turns the outer sides of the eye frusta
+	// outwards; a frustum with these sides pulled back until they pass
+	// through the eyes encloses both
+	Real offset = Math::Abs(mHmdCfg.projectionCenterOffset);
+	Real slope = aspectRatio * Math::Tan(Radian(Degree(FOVY)) * 0.5f) * (1 + offset);
+	Real back = mHmdCfg.interPupillaryDistance * 0.5f / slope;
+
+	mCullingFrustum->setAspectRatio(aspectRatio * (1 + offset));
+	mCullingFrustum->setFarClipDistance(FAR_CLIP + back);
+	mCullingNode->setPosition(0, 0, back);
+}
+
+void StereoVisibility::updateCounters() {
+	Profiler &profiler = Profiler::getSingleton();
+	SharedLodStrategy *lod = dynamic_cast<SharedLodStrategy*>(LodStrategyManager::getSingleton().getStrategy("Distance"));
+
+	if (lod) {
+		unsigned long evaluations = lod->getEvaluations() - mLastLodEvaluations;
+		profiler.setCounter("lodEvaluations", evaluations);
+		profiler.setCounter("lodEvaluationsSaved", evaluations / 2);
+		mLastLodEvaluations = lod->getEvaluations();
+	}
+
+	unsigned long tests = mCullingFrustum->getTests() - mLastTests;
+	profiler.setCounter("visibilityTests", tests);
+	profiler.setCounter("visibilityTestsSaved", tests / 2);
+	mLastTests = mCullingFrustum->getTests();
+}
+
+} /* namespace HMD */
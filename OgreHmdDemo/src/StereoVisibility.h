@@ -0,0 +1,103 @@
+#ifndef __StereoVisibility_h_
+#define __StereoVisibility_h_
+
+#include <OgreRoot.h>
+#include <OgreCamera.h>
+#include <OgreFrustum.h>
+#include <OgreDistanceLodStrategy.h>
+#include "HmdConfig.h"
+
+namespace HMD {
+
+using namespace Ogre;
+
+/*
+ * LOD strategy registered as "Distance" in place of Ogre's, which computes
+ * every value. It only counts the evaluations of the eye passes, which pass
+ * the shared LOD camera; that camera alone makes both eyes pick the same
+ * levels. The original stays alive (materials created before the swap refer
+ * to it) and is owned by this strategy.
+ */
+class SharedLodStrategy: public LodStrategy {
+public:
+	SharedLodStrategy(DistanceLodStrategy *distance);
+	virtual ~SharedLodStrategy();
+
+	// everything but the value is the original's
+	virtual Real getBaseValue() const;
+	virtual Real transformBias(Real factor) const;
+	virtual Real transformUserValue(Real userValue) const;
+	virtual ushort getIndex(Real value, const Mesh::MeshLodUsageList &meshLodUsageList) const;
+	virtual ushort getIndex(Real value, const Material::LodValueList &materialLodValueList) const;
+	virtual void sort(Mesh::MeshLodUsageList &meshLodUsageList) const;
+	virtual bool isSorted(const Mesh::LodValueList &values) const;
+
+	// Only evaluations for this camera are counted
+	void setLodCamera(const Camera *camera) { mLodCamera = camera; }
+	unsigned long getEvaluations() const { return mEvaluations; }
+
+protected:
+	virtual Real getValueImpl(const MovableObject *movableObject, const Camera *camera) const;
+
+private:
+	DistanceLodStrategy *mDistance;
+	const Camera *mLodCamera;
+	mutable unsigned long mEvaluations;
+};
+
+/*
+ * Culling frustum enclosing both eye frusta, so both eyes cull the same
+ * nodes. The results are not cached for the second eye: looking one up costs
+ * about as much as the six plane test it would save.
+ */
+class SharedCullingFrustum: public Frustum {
+public:
+	SharedCullingFrustum(const String &name);
+
+	virtual bool isVisible(const AxisAlignedBox &bound, FrustumPlane *culledBy = 0) const;
+	using Frustum::isVisible;
+
+	unsigned long getTests() const { return mTests; }
+
+private:
+	mutable unsigned long mTests;
+};
+
+/*
+ * Drives LOD selection and visibility of both eyes from the centre of the
+ * head: a centre LOD camera and a widened culling frustum behind it. Both
+ * eyes make the same decisions, so the second eye's share of the
+ * evaluations repeats the first eye's and is reported as saved, half of the
+ * evaluations of a frame rather than a count of cache hits.
+ * Counters: lodEvaluations, lodEvaluationsSaved, visibilityTests,
+ * visibilityTestsSaved (per frame).
+ */
+class StereoVisibility {
+public:
+	StereoVisibility(SceneManager *sceneMgr, SceneNode *cameraNode, const HmdConfig &hmdCfg);
+	~StereoVisibility();
+
+	// Replaces the "Distance" LOD strategy, must run before materials and meshes are created
+	static void installSharedLodStrategy(void);
+
+	// Lets the eye camera use the shared LOD camera and culling frustum
+	void attach(Camera *eye);
+	// Aspect ratio of one eye viewport
+	void setAspectRatio(Real aspectRatio);
+	// Publishes the counters of the last frame
+	void updateCounters(void);
+
+	Camera* getLodCamera() const { return mLodCamera; }
+
+private:
+	SceneManager *mSceneMgr;
+	const HmdConfig &mHmdCfg;
+	Camera *mLodCamera;
+	SharedCullingFrustum *mCullingFrustum;
+	SceneNode *mCullingNode;
+	unsigned long mLastLodEvaluations;
+	unsigned long mLastTests;
+};
+
+} /* namespace HMD */
+#endif // #ifndef __StereoVisibility_h_
@@ -0,0 +1,540 @@
+/*
+ * hmdmeshopt - build time mesh optimization
+ *
+ * Usage: hmdmeshopt [--lod d1,d2,...] [--materials dir] [--keep semantic,...] <in.mesh> <out.mesh>
+ *   - strips vertex attributes no material of the mesh uses, looked up in the
+ *     material scripts of --materials: texture coordinate sets beyond the
+ *     highest tex_coord_set and vertex colours without a vertexcolour
+ *     reference. Materials with a vertex program, or which are not found,
+ *     keep every attribute; so does everything without --materials.
+ *     Position, normal and the first texture coordinates are always kept
+ *     (--keep adds any of diffuse, specular, tangent, binormal, texcoord)
+ *   - generates distance LOD levels with Ogre's ProgressiveMesh, by default at
+ *     8, 16 and 32 times the bounding radius (--lod 0 disables them)
+ *   - reorders all index buffers for the post-transform vertex cache (Forsyth)
+ * and reports the ACMR (average cache miss ratio) of a 16 entry FIFO cache,
+ * the vertex size and the vertices referenced per LOD level.
+ */
+#include <OgreRoot.h>
+#include <OgreMeshManager.h>
+#include <OgreMeshSerializer.h>
+#include <OgreSubMesh.h>
+#include <OgreProgressiveMesh.h>
+#include <OgreDistanceLodStrategy.h>
+#include <OgreDefaultHardwareBufferManager.h>
+#include <OgreLogManager.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+
+using namespace Ogre;
+
+#define CACHE_SIZE 32
+#define FIFO_SIZE 16
+#define LOD_REDUCTION 0.5f
+#define MATERIAL_GROUP "hmdmeshopt"
+#define MAX_INHERITANCE 8
+
+typedef std::vector<uint32> IndexList;
+
+// Top level material definitions of the scripts: name -> parent and body words
+struct MaterialScript {
+	String parent;
+	StringVector words;
+};
+
+typedef std::map<String, MaterialScript> MaterialScripts;
+
+// Vertex attributes the materials of a vertex buffer read
+struct AttributeUsage {
+	// a vertex program may read anything, as does an unknown material
+	bool all;
+	unsigned short texCoordSets;
+	bool vertexColour;
+
+	AttributeUsage() : all(false), texCoordSets(1), vertexColour(false) {}
+
+	void add(const AttributeUsage &other) {
+		all = all || other.all;
+		texCoordSets = std::max(texCoordSets, other.texCoordSets);
+		vertexColour = vertexColour || other.vertexColour;
+	}
+};
+
+// Splits a script into words and braces, without comments and quotes
+static StringVector tokenize(const String &text) {
+	StringVector words;
+	size_t i = 0, n = text.size();
+
+	while (i < n) {
+		if (isspace((uchar) text[i])) {
+			i++;
+		} else if (text.compare(i, 2, "//") == 0) {
+			while (i < n && text[i] != '\n')
+				i++;
+		} else if (text.compare(i, 2, "/*") == 0) {
+			size_t end = text.find("*/", i + 2);
+			i = end == String::npos ? n : end + 2;
+		} else if (text[i] == '{' || text[i] == '}' || text[i] == ':') {
+			words.push_back(String(1, text[i++]));
+		} else {
+			size_t start = i;
+			while (i < n && !isspace((uchar) text[i]) && text[i] != '{' && text[i] != '}' && text[i] != ':')
+				i++;
+			words.push_back(StringUtil::replaceAll(text.substr(start, i - start), "\"", ""));
+		}
+	}
+
+	return words;
+}
+
+static void indexMaterials(const String &text, MaterialScripts &scripts) {
+	StringVector words = tokenize(text);
+	int depth = 0;
+
+	for (size_t i = 0; i < words.size(); i++) {
+		if (words[i] == "{") {
+			depth++;
+		} else if (words[i] == "}") {
+			depth--;
+		} else if (depth == 0 && words[i] == "material" && i + 1 < words.size()) {
+			MaterialScript script;
+			String name = words[++i];
+
+			if (i + 2 < words.size() && words[i + 1] == ":")
+				script.parent = words[i + 2];
+
+			while (i < words.size() && words[i] != "{")
+				i++;
+
+			for (int inner = 0; ++i < words.size();) {
+				if (words[i] == "{")
+					inner++;
+				else if (words[i] == "}" && inner-- == 0)
+					break;
+
+				script.words.push_back(words[i]);
+			}
+
+			// like the script compiler the first definition of a name wins
+			if (scripts.find(name) == scripts.end())
+				scripts[name] = script;
+		}
+	}
+}
+
+static AttributeUsage getUsage(const String &material, const MaterialScripts &scripts, int depth = 0) {
+	MaterialScripts::const_iterator it = scripts.find(material);
+	AttributeUsage usage;
+
+	if (it == scripts.end() || depth > MAX_INHERITANCE) {
+		usage.all = true;
+		return usage;
+	}
+
+	const StringVector &words = it->second.words;
+
+	if (!it->second.parent.empty())
+		usage.add(getUsage(it->second.parent, scripts, depth + 1));
+
+	for (size_t i = 0; i < words.size(); i++) {
+		if (StringUtil::endsWith(words[i], "vertex_program_ref"))
+			usage.all = true;
+		else if (words[i] == "vertexcolour")
+			usage.vertexColour = true;
+		else if (words[i] == "tex_coord_set" && i + 1 < words.size())
+			usage.texCoordSets = std::max(usage.texCoordSets,
+					(unsigned short) (StringConverter::parseUnsignedInt(words[i + 1]) + 1));
+		else if ((words[i] == "shadow_caster_material" || words[i] == "shadow_receiver_material")
+				&& i + 1 < words.size())
+			usage.add(getUsage(words[i + 1], scripts, depth + 1));
+	}
+
+	return usage;
+}
+
+static IndexList readIndices(IndexData *indexData) {
+	IndexList indices(indexData->indexCount);
+	HardwareIndexBufferSharedPtr buffer = indexData->indexBuffer;
+
+	if (buffer.isNull() || indices.empty())
+		return indices;
+
+	bool wide = buffer->getType() == HardwareIndexBuffer::IT_32BIT;
+	const uchar *data = (const uchar*) buffer->lock(HardwareBuffer::HBL_READ_ONLY)
+			+ indexData->indexStart * buffer->getIndexSize();
+
+	for (size_t i = 0; i < indices.size(); i++)
+		indices[i] = wide ? ((const uint32*) data)[i] : ((const uint16*) data)[i];
+
+	buffer->unlock();
+	return indices;
+}
+
+static void writeIndices(IndexData *indexData, const IndexList &indices) {
+	HardwareIndexBufferSharedPtr buffer = indexData->indexBuffer;
+	bool wide = buffer->getType() == HardwareIndexBuffer::IT_32BIT;
+	uchar *data = (uchar*) buffer->lock(HardwareBuffer::HBL_NORMAL) + indexData->indexStart * buffer->getIndexSize();
+
+	for (size_t i = 0; i < indices.size(); i++) {
+		if (wide)
+			((uint32*) data)[i] = indices[i];
+		else
+			((uint16*) data)[i] = (uint16) indices[i];
+	}
+
+	buffer->unlock();
+}
+
+// Post-transform cache misses per triangle of a FIFO cache
+static float computeAcmr(const IndexList &indices) {
+	std::vector<uint32> fifo;
+	size_t misses = 0;
+
+	for (size_t i = 0; i < indices.size(); i++) {
+		if (std::find(fifo.begin(), fifo.end(), indices[i]) != fifo.end())
+			continue;
+
+		misses++;
+		fifo.push_back(indices[i]);
+
+		if (fifo.size() > FIFO_SIZE)
+			fifo.erase(fifo.begin());
+	}
+
+	return indices.size() < 3 ? 0 : float(misses) / (indices.size() / 3);
+}
+
+// Forsyth's "Linear-Speed Vertex Cache Optimisation" scoring
+static float vertexScore(int cachePosition, size_t valence) {
+	if (valence == 0)
+		return -1;
+
+	float score = 0;
+
+	if (cachePosition >= 0) {
+		if (cachePosition < 3)
+			score = 0.75f;
+		else
+			score = std::pow(1 - float(cachePosition - 3) / (CACHE_SIZE - 3), 1.5f);
+	}
+
+	return score + 2.0f / std::sqrt(float(valence));
+}
+
+static IndexList optimizeVertexCache(const IndexList &indices, size_t vertexCount) {
+	size_t triangleCount = indices.size() / 3;
+	std::vector<std::vector<size_t> > vertexTriangles(vertexCount);
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32> cache;
+	IndexList result;
+
+	for (size_t t = 0; t < triangleCount; t++) {
+		for (int k = 0; k < 3; k++)
+			vertexTriangles[indices[t * 3 + k]].push_back(t);
+	}
+
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScores[v] = vertexScore(-1, vertexTriangles[v].size());
+
+	for (size_t t = 0; t < triangleCount; t++)
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+	result.reserve(indices.size());
+
+	while (result.size() < indices.size()) {
+		// best triangle touching the cache, a full scan only when the cache has none left
+		long best = -1;
+
+		for (size_t c = 0; c < cache.size(); c++) {
+			const std::vector<size_t> &triangles = vertexTriangles[cache[c]];
+
+			for (size_t i = 0; i < triangles.size(); i++) {
+				if (best < 0 || triangleScores[triangles[i]] > triangleScores[best])
+					best = triangles[i];
+			}
+		}
+
+		if (best < 0) {
+			for (size_t t = 0; t < triangleCount; t++) {
+				if (!emitted[t] && (best < 0 || triangleScores[t] > triangleScores[best]))
+					best = t;
+			}
+		}
+
+		emitted[best] = true;
+
+		for (int k = 0; k < 3; k++) {
+			uint32 v = indices[best * 3 + k];
+			std::vector<size_t> &triangles = vertexTriangles[v];
+
+			result.push_back(v);
+			triangles.erase(std::find(triangles.begin(), triangles.end(), (size_t) best));
+
+			std::vector<uint32>::iterator cached = std::find(cache.begin(), cache.end(), v);
+			if (cached != cache.end())
+				cache.erase(cached);
+			cache.insert(cache.begin(), v);
+		}
+
+		// vertices pushed out of the cache lose their cache bonus
+		std::vector<uint32> touched(cache);
+
+		if (cache.size() > CACHE_SIZE) {
+			for (size_t c = CACHE_SIZE; c < cache.size(); c++)
+				cachePosition[cache[c]] = -1;
+			cache.resize(CACHE_SIZE);
+		}
+
+		for (size_t c = 0; c < cache.size(); c++)
+			cachePosition[cache[c]] = c;
+
+		for (size_t i = 0; i < touched.size(); i++) {
+			uint32 v = touched[i];
+			float delta = vertexScore(cachePosition[v], vertexTriangles[v].size()) - vertexScores[v];
+
+			vertexScores[v] += delta;
+
+			for (size_t j = 0; j < vertexTriangles[v].size(); j++)
+				triangleScores[vertexTriangles[v][j]] += delta;
+		}
+	}
+
+	return result;
+}
+
+static size_t countReferencedVertices(const IndexList &indices) {
+	return std::set<uint32>(indices.begin(), indices.end()).size();
+}
+
+static bool keepElement(const VertexElement &element, const AttributeUsage &usage, const std::set<String> &keep) {
+	if (usage.all)
+		return true;
+
+	switch (element.getSemantic()) {
+	case VES_POSITION:
+	case VES_NORMAL:
+	case VES_BLEND_INDICES:
+	case VES_BLEND_WEIGHTS:
+		return true;
+	case VES_TEXTURE_COORDINATES:
+		return element.getIndex() < usage.texCoordSets || keep.count("texcoord");
+	case VES_DIFFUSE:
+		return usage.vertexColour || keep.count("diffuse");
+	case VES_SPECULAR:
+		return usage.vertexColour || keep.count("specular");
+	case VES_TANGENT:
+		return keep.count("tangent") > 0;
+	case VES_BINORMAL:
+		return keep.count("binormal") > 0;
+	default:
+		return true;
+	}
+}
+
+// Removes the vertex elements no material uses, returns the new vertex size
+static size_t stripVertexData(VertexData *vertexData, const AttributeUsage &usage, const std::set<String> &keep,
+		bool animated) {
+	VertexDeclaration *declaration = vertexData->vertexDeclaration->clone();
+	const VertexDeclaration::VertexElementList &elements = vertexData->vertexDeclaration->getElements();
+
+	for (VertexDeclaration::VertexElementList::const_reverse_iterator it = elements.rbegin(); it != elements.rend(); ++it) {
+		if (!keepElement(*it, usage, keep))
+			declaration->removeElement(it->getSemantic(), it->getIndex());
+	}
+
+	VertexDeclaration *organised = declaration->getAutoOrganisedDeclaration(animated, false, false);
+	HardwareBufferManager::getSingleton().destroyVertexDeclaration(declaration);
+	vertexData->reorganiseBuffers(organised);
+
+	size_t size = 0;
+
+	for (unsigned short source = 0; source <= organised->getMaxSource(); source++)
+		size += organised->getVertexSize(source);
+
+	return size;
+}
+
+static size_t getVertexSize(VertexData *vertexData) {
+	size_t size = 0;
+	VertexDeclaration *declaration = vertexData->vertexDeclaration;
+
+	if (declaration->getElementCount() == 0)
+		return 0;
+
+	for (unsigned short source = 0; source <= declaration->getMaxSource(); source++)
+		size += declaration->getVertexSize(source);
+
+	return size;
+}
+
+static void optimize(Mesh *mesh, const LodValueList &lodValues, const MaterialScripts &materials,
+		const std::set<String> &keep) {
+	bool animated = mesh->hasSkeleton();
+	AttributeUsage sharedUsage;
+
+	for (unsigned short i = 0; i < mesh->getNumSubMeshes(); i++) {
+		if (mesh->getSubMesh(i)->useSharedVertices)
+			sharedUsage.add(getUsage(mesh->getSubMesh(i)->getMaterialName(), materials));
+	}
+
+	// attributes
+	if (mesh->sharedVertexData) {
+		size_t before = getVertexSize(mesh->sharedVertexData);
+		size_t after = stripVertexData(mesh->sharedVertexData, sharedUsage, keep, animated);
+		std::cout << "  shared vertices: " << mesh->sharedVertexData->vertexCount << ", "
+				<< before << " -> " << after << " bytes per vertex" << std::endl;
+	}
+
+	for (unsigned short i = 0; i < mesh->getNumSubMeshes(); i++) {
+		SubMesh *sub = mesh->getSubMesh(i);
+
+		if (!sub->useSharedVertices) {
+			size_t before = getVertexSize(sub->vertexData);
+			size_t after = stripVertexData(sub->vertexData, getUsage(sub->getMaterialName(), materials), keep, animated);
+			std::cout << "  submesh " << i << " vertices: " << sub->vertexData->vertexCount << ", "
+					<< before << " -> " << after << " bytes per vertex" << std::endl;
+		}
+	}
+
+	// distance LOD levels, to be selected by the shared stereo LOD camera
+	mesh->setLodStrategy(DistanceLodStrategy::getSingletonPtr());
+
+	if (!lodValues.empty())
+		ProgressiveMesh::generateLodLevels(mesh, lodValues, ProgressiveMesh::VRQ_PROPORTIONAL, LOD_REDUCTION);
+
+	// index order of every level
+	for (unsigned short i = 0; i < mesh->getNumSubMeshes(); i++) {
+		SubMesh *sub = mesh->getSubMesh(i);
+		size_t vertexCount = (sub->useSharedVertices ? mesh->sharedVertexData : sub->vertexData)->vertexCount;
+
+		if (sub->operationType != RenderOperation::OT_TRIANGLE_LIST)
+			continue;
+
+		for (size_t level = 0; level <= sub->mLodFaceList.size(); level++) {
+			IndexData *indexData = level == 0 ? sub->indexData : sub->mLodFaceList[level - 1];
+			IndexList indices = readIndices(indexData);
+
+			if (indices.empty())
+				continue;
+
+			IndexList optimized = optimizeVertexCache(indices, vertexCount);
+			writeIndices(indexData, optimized);
+
+			std::cout << "  submesh " << i << " lod " << level << ": " << indices.size() / 3 << " triangles, "
+					<< countReferencedVertices(indices) << " vertices, ACMR "
+					<< computeAcmr(indices) << " -> " << computeAcmr(optimized) << std::endl;
+		}
+	}
+
+	// stencil shadows need the edge list of the final index order
+	mesh->freeEdgeList();
+	mesh->buildEdgeList();
+}
+
+static LodValueList parseValues(const String &list) {
+	LodValueList values;
+	StringVector items = StringUtil::split(list, ",");
+
+	for (size_t i = 0; i < items.size(); i++) {
+		Real value = StringConverter::parseReal(items[i]);
+
+		if (value > 0)
+			values.push_back(value);
+	}
+
+	return values;
+}
+
+int main(int argc, char *argv[]) {
+	String lodList, input, output;
+	StringVector materialDirs;
+	std::set<String> keep;
+	bool defaultLod = true;
+
+	for (int i = 1; i < argc; i++) {
+		String arg(argv[i]);
+
+		if (arg == "--lod" && i + 1 < argc) {
+			lodList = argv[++i];
+			defaultLod = false;
+		} else if (arg == "--materials" && i + 1 < argc) {
+			materialDirs.push_back(argv[++i]);
+		} else if (arg == "--keep" && i + 1 < argc) {
+			StringVector items = StringUtil::split(argv[++i], ",");
+			keep.insert(items.begin(), items.end());
+		} else if (input.empty()) {
+			input = arg;
+		} else {
+			output = arg;
+		}
+	}
+
+	if (output.empty()) {
+		std::cerr << "Usage: hmdmeshopt [--lod d1,d2,...] [--materials dir] [--keep semantic,...] <in.mesh> <out.mesh>"
+				<< std::endl;
+		return 1;
+	}
+
+	// Root provides the managers, meshes live in system memory buffers
+	LogManager *logManager = new LogManager();
+	logManager->createLog("hmdmeshopt.log", true, false, true);
+	Root *root = new Root(StringUtil::BLANK, StringUtil::BLANK, StringUtil::BLANK);
+	DefaultHardwareBufferManager *bufferManager = new DefaultHardwareBufferManager();
+	int status = 0;
+
+	try {
+		ResourceGroupManager &rgm = ResourceGroupManager::getSingleton();
+		MaterialScripts materials;
+
+		for (size_t i = 0; i < materialDirs.size(); i++)
+			rgm.addResourceLocation(materialDirs[i], "FileSystem", MATERIAL_GROUP);
+
+		if (!materialDirs.empty()) {
+			StringVectorPtr names = rgm.findResourceNames(MATERIAL_GROUP, "*.material");
+
+			for (size_t i = 0; i < names->size(); i++)
+				indexMaterials(rgm.openResource((*names)[i], MATERIAL_GROUP)->getAsString(), materials);
+		}
+
+		std::ifstream *in = OGRE_NEW_T(std::ifstream, MEMCATEGORY_GENERAL)(input.c_str(), std::ios::binary);
+
+		if (!*in) {
+			OGRE_DELETE_T(in, basic_ifstream, MEMCATEGORY_GENERAL);
+			OGRE_EXCEPT(Exception::ERR_FILE_NOT_FOUND, "Cannot open " + input, "hmdmeshopt");
+		}
+
+		DataStreamPtr stream(OGRE_NEW FileStreamDataStream(input, in, true));
+		MeshPtr mesh = MeshManager::getSingleton().createManual("hmdmeshopt", ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+		MeshSerializer serializer;
+
+		serializer.importMesh(stream, mesh.get());
+
+		LodValueList lodValues = parseValues(lodList);
+
+		if (defaultLod) {
+			Real radius = mesh->getBoundingSphereRadius();
+			lodValues.push_back(radius * 8);
+			lodValues.push_back(radius * 16);
+			lodValues.push_back(radius * 32);
+		}
+
+		std::cout << "hmdmeshopt: " << input << std::endl;
+		optimize(mesh.get(), lodValues, materials, keep);
+		serializer.exportMesh(mesh.get(), output);
+	} catch (Exception &e) {
+		std::cerr << "hmdmeshopt: " << e.getDescription() << std::endl;
+		status = 1;
+	}
+
+	delete root;
+	delete bufferManager;
+	delete logManager;
+	return status;
+}
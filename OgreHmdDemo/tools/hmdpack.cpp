@@ -0,0 +1,133 @@
+/*
+ * hmdpack - converts resource locations into a memory mappable resource pack
+ *
+ * Usage: hmdpack <output.pack> <type>:<location> [<type>:<location> ...]
+ *   type is any Ogre archive type, e.g. FileSystem or Zip. All files of the
+ *   locations are stored flat under their base name, like Ogre indexes them.
+ */
+#include <OgreRoot.h>
+#include <OgreArchiveManager.h>
+#include <OgreLogManager.h>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include "../src/PackFormat.h"
+
+using namespace Ogre;
+using namespace HMD;
+
+struct PackFile {
+	String name;
+	MemoryDataStreamPtr data;
+	uint32 modifiedTime;
+};
+
+static uint32 align(uint32 offset) {
+	return (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+}
+
+static void readLocation(const String &location, std::vector<PackFile> &files, std::set<String> &names) {
+	size_t separator = location.find(':');
+
+	if (separator == String::npos)
+		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Expected <type>:<location>, got " + location, "hmdpack");
+
+	Archive *archive = ArchiveManager::getSingleton().load(location.substr(separator + 1), location.substr(0, separator));
+	FileInfoListPtr infos = archive->listFileInfo(true, false);
+
+	for (FileInfoList::iterator it = infos->begin(); it != infos->end(); ++it) {
+		if (!names.insert(it->basename).second) {
+			std::cerr << "hmdpack: skipping duplicate " << it->filename << " in " << location << std::endl;
+			continue;
+		}
+
+		PackFile file;
+		DataStreamPtr stream = archive->open(it->filename);
+		file.name = it->basename;
+		file.data = MemoryDataStreamPtr(OGRE_NEW MemoryDataStream(stream));
+		file.modifiedTime = (uint32) archive->getModifiedTime(it->filename);
+		files.push_back(file);
+	}
+}
+
+static void writePack(const String &fileName, const std::vector<PackFile> &files) {
+	std::vector<PackEntry> entries(files.size());
+	String names;
+	PackHeader header;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+	header.version = PACK_VERSION;
+	header.entryCount = files.size();
+
+	uint32 namesOffset = sizeof(PackHeader) + files.size() * sizeof(PackEntry);
+
+	for (size_t i = 0; i < files.size(); i++) {
+		entries[i].nameOffset = namesOffset + names.size();
+		entries[i].nameLength = files[i].name.size();
+		entries[i].size = files[i].data->size();
+		entries[i].modifiedTime = files[i].modifiedTime;
+		entries[i].reserved = 0;
+		names += files[i].name;
+	}
+
+	uint32 offset = align(namesOffset + names.size());
+
+	for (size_t i = 0; i < files.size(); i++) {
+		entries[i].dataOffset = offset;
+		offset = align(offset + entries[i].size);
+	}
+
+	std::ofstream out(fileName.c_str(), std::ios::binary);
+	uint32 written = namesOffset + names.size();
+	const char padding[PACK_ALIGNMENT] = { 0 };
+
+	out.write((const char*) &header, sizeof(header));
+	out.write((const char*) &entries[0], entries.size() * sizeof(PackEntry));
+	out.write(names.data(), names.size());
+
+	for (size_t i = 0; i < files.size(); i++) {
+		out.write(padding, entries[i].dataOffset - written);
+		out.write((const char*) files[i].data->getPtr(), entries[i].size);
+		written = entries[i].dataOffset + entries[i].size;
+	}
+
+	if (!out)
+		OGRE_EXCEPT(Exception::ERR_CANNOT_WRITE_TO_FILE, "Cannot write " + fileName, "hmdpack");
+
+	std::cout << "hmdpack: " << fileName << ": " << files.size() << " files, " << written << " bytes" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 3) {
+		std::cerr << "Usage: hmdpack <output.pack> <type>:<location> [<type>:<location> ...]" << std::endl;
+		return 1;
+	}
+
+	// Root provides the archive factories, no plugins or render system needed
+	LogManager *logManager = new LogManager();
+	logManager->createLog("hmdpack.log", true, false, true);
+	Root *root = new Root(StringUtil::BLANK, StringUtil::BLANK, StringUtil::BLANK);
+	int status = 0;
+
+	try {
+		std::vector<PackFile> files;
+		std::set<String> names;
+
+		for (int i = 2; i < argc; i++)
+			readLocation(argv[i], files, names);
+
+		if (files.empty())
+			OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "No files found", "hmdpack");
+
+		writePack(argv[1], files);
+	} catch (Exception &e) {
+		std::cerr << "hmdpack: " << e.getDescription() << std::endl;
+		status = 1;
+	}
+
+	delete root;
+	delete logManager;
+	return status;
+}
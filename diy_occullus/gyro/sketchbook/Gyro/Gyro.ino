@@ -2,12 +2,14 @@
 // Arduino Wire library is required if I2Cdev I2CDEV_ARDUINO_WIRE implementation
 // is used in I2Cdev.h
 #include <Wire.h>
+#include <EEPROM.h>
 // I2Cdev, HMC5883L and ADXL345 must be installed as libraries, or else the .cpp/.h files
 // for all classes must be in the include path of your project
 #include "I2Cdev.h"
 #include "ADXL345.h"
 #include "HMC5883L.h"
 #include "L3G4200D.h"
+#include "helper_3dmath_fixed.h"
 // class default I2C address is 0x53
 // specific I2C addresses may be passed as a parameter here
 // ALT low = 0x53 (default for SparkFun 6DOF board)
@@ -23,17 +25,156 @@ L3G4200D gyro;
 
 int motionTrackerPower = A5;
 
-bool calculateZeroRate;
+// Zero rate calibration: gyro bias and noise from the running mean and
+// variance (Welford) of a window of samples taken at rest, kept in EEPROM
+// and reused on boot while the gyro temperature is close to the stored one
+#define CALIBRATION_WINDOW 800          // samples, 1 s at 800 Hz
+#define CALIBRATION_MAX_NOISE 40        // LSB standard deviation, more is motion
+#define CALIBRATION_SIGMAS 3            // zero rate threshold in standard deviations
+#define CALIBRATION_MAX_TEMP_DELTA 5    // degrees C
+#define CALIBRATION_MAGIC 0x4743        // "GC"
+#define CALIBRATION_VERSION 2
+#define CALIBRATION_ADDRESS 0
 
-uint8_t zeroRateCompensationIndex , zeroRateCompensationNSamples, gyroThreshHold;
+// Layout in EEPROM, followed by an 8 bit sum of its bytes
+struct Calibration {
+  uint16_t magic;
+  uint8_t version;
+  int8_t temperature;   // raw L3G4200D OUT_TEMP, -1 LSB per degree C
+  int16_t scale;        // dps, the scale the LSB below refer to
+  int16_t bias[3];      // 1/16 LSB
+  uint16_t noise[3];    // standard deviation, 1/16 LSB
+};
 
-uint8_t output[22];
+Calibration calibration;
+bool calibrating;
+uint16_t calibrationWindow = CALIBRATION_WINDOW;
+uint16_t calibrationCount;
+float calibrationMean[3], calibrationM2[3];
+
+int16_t gyroBias[3];
+int16_t gyroThreshHold;
+
+// Framed packets, the layout is duplicated in MotionTracker.cpp:
+//   0xA5, type, payload length, payload, 8 bit sum of type, length and payload
+// Config payload, sent after calibration, after every changed setting and
+// then every CONFIG_INTERVAL:
+//   gyro scale (dps), gyro rate (Hz), accel rate (Hz), gyro batch,
+//   channels (PACKET_HAS_*), zero rate threshold, HPF mode,
+//   output mode
+// Capabilities payload, the answer to CMD_QUERY:
+//   protocol version, gyro rates (RATE_*), scales (SCALE_*), max gyro batch,
+//   channels, output modes (1 << MODE_*), I2C transactions of the device setup
+//   and the ones the register cache saved
+// Ack payload, the answer to every other command: command, ACK_* status
+// Sample payload:
+//   flags (PACKET_HAS_*),
+//   elapsed time since the last packet (us), gyro sample count,
+//   gyro samples: the first absolute, the others as delta to the previous one,
+//   accel sample count and samples if flagged, mag if flagged,
+//   raw gyro temperature (int8) if flagged
+//   The gyro samples are bias corrected. They are within the zero rate
+//   threshold zeroed, except with the temperature channel on: then the host
+//   learns the bias left over below the threshold and applies it itself.
+// Calibration payload, after every calibration and after loading it on boot:
+//   source (CALIBRATION_STORED, CALIBRATION_MEASURED), raw gyro temperature,
+//   bias x, y, z and noise x, y, z (int16, 1/16 LSB), window (samples)
+// Orientation payload (MODE_ORIENTATION instead of sample packets):
+//   elapsed time since the last packet (us), integrated gyro sample count,
+//   orientation quaternion w, x, y, z (Q30 int32), newest gyro sample
+// Values are little endian int16, except gyro deltas: one int8 per axis, or
+// DELTA_ESCAPE followed by the int16 delta if it does not fit.
+#define PACKET_SYNC 0xA5
+#define PACKET_SAMPLES 1
+#define PACKET_CONFIG 2
+#define PACKET_CAPABILITIES 3
+#define PACKET_ACK 4
+#define PACKET_ORIENTATION 5
+#define PACKET_CALIBRATION 6
+#define CALIBRATION_STORED 0
+#define CALIBRATION_MEASURED 1
+#define PACKET_HEADER 3
+#define PACKET_HAS_ACCEL 0x01
+#define PACKET_HAS_MAG 0x02
+#define PACKET_HAS_TEMP 0x04
+#define ALL_CHANNELS (PACKET_HAS_ACCEL | PACKET_HAS_MAG | PACKET_HAS_TEMP)
+#define DELTA_ESCAPE -128
+#define MAX_PAYLOAD 255
+// Keeps the worst case, all deltas escaped plus accel and mag, in MAX_PAYLOAD
+#define MAX_GYRO_SAMPLES 20
+#define MAX_ACCEL_SAMPLES 8
+#define CONFIG_INTERVAL 1000000
+// The die temperature changes slowly, one I2C read per second is plenty
+#define TEMP_INTERVAL 1000000
+
+// Commands from the host, same framing, payload as noted
+#define PROTOCOL_VERSION 4
+#define CMD_QUERY 0x10          // none
+#define CMD_SET_RATE 0x11       // gyro rate (Hz), int16
+#define CMD_SET_SCALE 0x12      // gyro scale (dps), int16
+#define CMD_SET_WATERMARK 0x13  // gyro samples per packet, uint8
+#define CMD_SET_CHANNELS 0x14   // PACKET_HAS_*, uint8
+#define CMD_SET_THRESHOLD 0x15  // zero rate threshold, int16
+#define CMD_SET_HPF 0x16        // L3G4200D_HPF_MODE_*, uint8
+#define CMD_SET_MODE 0x17       // MODE_*, uint8
+#define CMD_CALIBRATE 0x18      // window (samples, 0 = CALIBRATION_WINDOW), int16
+#define MAX_COMMAND_PAYLOAD 8
+#define ACK_OK 0
+#define ACK_INVALID 1
+#define ACK_UNKNOWN 2
+#define RATE_100 0x01
+#define RATE_200 0x02
+#define RATE_400 0x04
+#define RATE_800 0x08
+#define SCALE_250 0x01
+#define SCALE_500 0x02
+#define SCALE_2000 0x04
+// Send every gyro sample, or integrate them at the full rate on the device
+// and send the orientation once per batch
+#define MODE_SAMPLES 0
+#define MODE_ORIENTATION 1
+// Fraction bits of the half angle factor in sendOrientation()
+#define HALF_ANGLE_SHIFT 4
+
+#define ACCEL_RATE 100
+// Ignored by native USB serial (Leonardo), which always runs at USB speed
+#define SERIAL_BAUD 115200
+
+// INT2 (DRDY) of the L3G4200D wired to pin 7, interrupt 4 on the Leonardo
+#define GYRO_DRDY_INTERRUPT 4
+// Timestamps of the data ready edges, a power of two so the indices wrap
+#define DRDY_RING_SIZE 64
+
+// Single producer (ISR), single consumer (loop) ring: the ISR only writes
+// drdyHead, the loop only writes drdyTail and both are single byte, so no
+// interrupts have to be disabled
+volatile unsigned long drdyTimes[DRDY_RING_SIZE];
+volatile uint8_t drdyHead, drdyTail;
+// Poll anyway if no edge arrived for this long (us)
+#define DRDY_TIMEOUT 5000
+
+uint8_t output[PACKET_HEADER + MAX_PAYLOAD + 1];
 uint8_t buffer[6];
+uint8_t gyroSamples[MAX_GYRO_SAMPLES * 6];
+uint8_t command[PACKET_HEADER + MAX_COMMAND_PAYLOAD + 1];
+uint8_t commandLength;
+
+// Settings the host can change at runtime
+int16_t gyroRate = 800;
+// Gyro samples per packet (the FIFO watermark at which the loop drains it),
+// fewer packets spend less on framing
+uint8_t gyroBatch = 4;
+uint8_t channels = ALL_CHANNELS;
+uint8_t hpfMode = L3G4200D_HPF_MODE_NORMAL;
+uint8_t outputMode = MODE_SAMPLES;
+
+QuaternionQ30 orientation;
 
 int16_t x, y, z;
-int16_t gyroXZR, gyroYZR, gyroZZR;
+int16_t scaleRate;
 
-unsigned long prevTime, currentTime;
+unsigned long prevTime, currentTime, configTime, tempTime;
+uint16_t setupTransactions, setupSavedTransactions;
 
 void setup() {
   //Enable PowerSupply to Motion Shield
@@ -44,74 +185,52 @@ void setup() {
   Wire.begin();
 
   // initialize serial communication
-  // (38400 chosen because it works as well at 8MHz as it does at 16MHz, but
-  // it's really up to you depending on your project)
-  Serial.begin(38400);
+  // (800 gyro samples/s in batches of 4 take 4.6 kB/s with the compact
+  // packets, about 5.8 kB/s with accel and mag)
+  Serial.begin(SERIAL_BAUD);
 
   // initialize device
   Serial.println("Initializing I2C devices...");
+  accel.enableRegisterCache();
+  mag.enableRegisterCache();
+  gyro.enableRegisterCache();
   accel.initialize();
   mag.initialize();
   gyro.initialize();
 
   //setup devices
   setupGyro();
+  setupAccel();
+  setupMag();
 
-  calculateZeroRate = true;
-  zeroRateCompensationIndex = 0;
-  zeroRateCompensationNSamples = 50;
-  gyroThreshHold = 50;
+  // both sensors queue their samples, every packet drains the queues
+  setupFIFO();
+#ifdef I2CDEV_REGISTER_CACHE
+  setupTransactions = I2Cdev::transactions;
+  setupSavedTransactions = I2Cdev::savedTransactions;
+#endif
   prevTime = micros();
+  drdyTail = drdyHead;
+  attachInterrupt(GYRO_DRDY_INTERRUPT, gyroDataReady, RISING);
+
+  if(loadCalibration()){
+    sendCalibration(CALIBRATION_STORED);
+    sendConfig();
+  }
+  else {
+    startCalibration(CALIBRATION_WINDOW);
+  }
 
 }
 
 void loop() {
   if(true){ // No Debug
-    if(calculateZeroRate){
-      if(zeroRateCompensationIndex <= zeroRateCompensationNSamples){
-        gyro.getRotations(&x,&y,&z);
-        gyroXZR += abs(x);
-        gyroYZR += abs(y);
-        gyroZZR += abs(z);
-        zeroRateCompensationIndex++;
-      } 
-      else {        
-        calculateZeroRate = false;
-        gyroXZR /= zeroRateCompensationNSamples;
-        gyroYZR /= zeroRateCompensationNSamples;
-        gyroZZR /= zeroRateCompensationNSamples;
-
-        gyroThreshHold = (gyroXZR + gyroYZR + gyroZZR) / 3;
-      }
+    receiveCommands();
+    if(calibrating){
+      calibrate();
     } 
     else {
-      gyro.getRotations(&x,&y,&z);
-      x = abs(x)-gyroXZR > gyroThreshHold ? x : 0;
-      y = abs(y)-gyroYZR > gyroThreshHold ? y : 0;
-      z = abs(z)-gyroZZR > gyroThreshHold ? z : 0;      
-      convertAndInsert(x, 0);
-      convertAndInsert(y, 2);
-      convertAndInsert(z, 4);      
-      accel.getRawAcceleration(buffer);
-      output[6] = buffer[0];
-      output[7] = buffer[1];
-      output[8] = buffer[2];
-      output[9] = buffer[3];
-      output[10] = buffer[4];
-      output[11] = buffer[5];
-      mag.getHeading(&x,&y,&z);
-      output[12] = buffer[0];
-      output[13] = buffer[1];
-      output[14] = buffer[2];
-      output[15] = buffer[3];
-      output[16] = buffer[4];
-      output[17] = buffer[5];
-
-      currentTime = micros();
-      convertAndInsert(((int16_t)currentTime - prevTime), 20);
-      Serial.write(output, 22);     
-      prevTime = currentTime; 
-
+      sendSamples();
     }
   } 
   else {
@@ -120,41 +239,599 @@ void loop() {
   }
 }
 
+void gyroDataReady(){
+  uint8_t next = (drdyHead + 1) & (DRDY_RING_SIZE - 1);
+  if(next == drdyTail){
+    return;
+  }
+  drdyTimes[drdyHead] = micros();
+  drdyHead = next;
+}
+
+// Time of the newest of count samples read from the gyro FIFO. Every FIFO
+// sample raised one data ready edge, the oldest edges belong to the oldest
+// samples.
+unsigned long popSampleTime(uint8_t count){
+  unsigned long time = 0;
+  bool found = false;
+
+  while(count-- > 0 && drdyTail != drdyHead){
+    time = drdyTimes[drdyTail];
+    drdyTail = (drdyTail + 1) & (DRDY_RING_SIZE - 1);
+    found = true;
+  }
+
+  // edges of samples lost to a FIFO overrun would delay all later times
+  while(((drdyHead - drdyTail) & (DRDY_RING_SIZE - 1)) > L3G4200D_FIFO_SIZE){
+    drdyTail = (drdyTail + 1) & (DRDY_RING_SIZE - 1);
+  }
+
+  // no edges: DRDY not wired or the samples were queued before attaching
+  return found ? time : micros();
+}
+
+// Reads a batch of gyro samples into gyroSamples and sets currentTime to the
+// time of the newest one, 0 while the batch is not complete
+uint8_t readGyroFIFO(){
+  // wait for a batch of data ready edges, the FIFO is filled meanwhile and
+  // the serial transmit interrupt drains the previous packet
+  uint8_t ready = (drdyHead - drdyTail) & (DRDY_RING_SIZE - 1);
+  if(ready < gyroBatch && micros() - prevTime < DRDY_TIMEOUT){
+    return 0;
+  }
+
+  uint8_t gyroCount = min(gyro.getFIFOLength(), MAX_GYRO_SAMPLES);
+  if(gyroCount == 0){
+    return 0;
+  }
+
+  gyroCount = gyro.getFIFORotations(gyroSamples, gyroCount);
+  currentTime = popSampleTime(gyroCount);
+  return gyroCount;
+}
+
+void sendSamples(){
+  uint8_t gyroCount = readGyroFIFO();
+  if(gyroCount == 0){
+    return;
+  }
+
+  unsigned long elapsed = min(currentTime - prevTime, 65535UL);
+  prevTime = currentTime;
+
+  if(outputMode == MODE_ORIENTATION){
+    sendOrientation(gyroCount, elapsed);
+  }
+  else {
+    sendGyroSamples(gyroCount, elapsed);
+  }
+
+  // the host may open the port at any time
+  if(currentTime - configTime >= CONFIG_INTERVAL){
+    sendConfig();
+  }
+}
+
+// Sets x, y and z to the zero rate compensated sample i of gyroSamples:
+// bias removed, rates within the noise threshold are zero unless the host
+// applies the threshold
+void readGyroSample(uint8_t i){
+  x = convert(gyroSamples + i * 6) - gyroBias[0];
+  y = convert(gyroSamples + i * 6 + 2) - gyroBias[1];
+  z = convert(gyroSamples + i * 6 + 4) - gyroBias[2];
+  if(!hostThreshold()){
+    x = abs(x) > gyroThreshHold ? x : 0;
+    y = abs(y) > gyroThreshHold ? y : 0;
+    z = abs(z) > gyroThreshHold ? z : 0;
+  }
+}
+
+// The host models the bias left after calibration against the temperature.
+// The threshold would zero that bias at rest, so the host applies it after
+// subtracting its model
+bool hostThreshold(){
+  return outputMode == MODE_SAMPLES && (channels & PACKET_HAS_TEMP);
+}
+
+void startCalibration(uint16_t window){
+  calibrating = true;
+  calibrationWindow = window;
+  calibrationCount = 0;
+  for(uint8_t axis = 0; axis < 3; axis++){
+    calibrationMean[axis] = 0;
+    calibrationM2[axis] = 0;
+  }
+}
+
+// Welford's running mean and variance over the raw samples, no sums that
+// can overflow and no loss of precision for long windows
+void calibrate(){
+  uint8_t gyroCount = readGyroFIFO();
+  if(gyroCount == 0){
+    return;
+  }
+  prevTime = currentTime;
+
+  for(uint8_t i = 0; i < gyroCount; i++){
+    calibrationCount++;
+    for(uint8_t axis = 0; axis < 3; axis++){
+      float value = convert(gyroSamples + i * 6 + axis * 2);
+      float delta = value - calibrationMean[axis];
+      calibrationMean[axis] += delta / calibrationCount;
+      calibrationM2[axis] += delta * (value - calibrationMean[axis]);
+    }
+  }
+
+  if(calibrationCount < calibrationWindow){
+    return;
+  }
+
+  float maxNoise = 0;
+  for(uint8_t axis = 0; axis < 3; axis++){
+    float noise = sqrt(calibrationM2[axis] / (calibrationCount - 1));
+    calibration.bias[axis] = (int16_t) (calibrationMean[axis] * 16);
+    calibration.noise[axis] = (uint16_t) (noise * 16);
+    maxNoise = max(maxNoise, noise);
+  }
+
+  // moved during the window: start over
+  if(maxNoise > CALIBRATION_MAX_NOISE){
+    startCalibration(calibrationWindow);
+    return;
+  }
+
+  calibration.magic = CALIBRATION_MAGIC;
+  calibration.version = CALIBRATION_VERSION;
+  calibration.temperature = gyro.getTemperature();
+  calibration.scale = scaleRate;
+  saveCalibration();
+  applyCalibration();
+  calibrating = false;
+
+  sendCalibration(CALIBRATION_MEASURED);
+  sendConfig();
+}
+
+void applyCalibration(){
+  uint16_t maxNoise = 0;
+  for(uint8_t axis = 0; axis < 3; axis++){
+    gyroBias[axis] = (calibration.bias[axis] + (calibration.bias[axis] >= 0 ? 8 : -8)) / 16;
+    maxNoise = max(maxNoise, calibration.noise[axis]);
+  }
+  gyroThreshHold = (maxNoise * CALIBRATION_SIGMAS + 15) / 16;
+}
+
+// True if EEPROM holds a calibration taken at about the current temperature
+bool loadCalibration(){
+  uint8_t *bytes = (uint8_t *) &calibration;
+  uint8_t checksum = 0;
+
+  for(uint8_t i = 0; i < sizeof(calibration); i++){
+    bytes[i] = EEPROM.read(CALIBRATION_ADDRESS + i);
+    checksum += bytes[i];
+  }
+
+  if(checksum != EEPROM.read(CALIBRATION_ADDRESS + sizeof(calibration))
+      || calibration.magic != CALIBRATION_MAGIC || calibration.version != CALIBRATION_VERSION){
+    return false;
+  }
+  int8_t temperature = gyro.getTemperature();
+  if(abs(calibration.temperature - temperature) > CALIBRATION_MAX_TEMP_DELTA){
+    return false;
+  }
+  if(calibration.scale != 250 && calibration.scale != 500 && calibration.scale != 2000){
+    return false;
+  }
+
+  // measured after the host changed the scale
+  rescaleCalibration();
+  applyCalibration();
+  calibrating = false;
+  return true;
+}
+
+// Converts bias and noise to the LSB of the current scale
+void rescaleCalibration(){
+  float ratio = sensitivity(calibration.scale) / gyroSensitivity();
+  for(uint8_t axis = 0; axis < 3; axis++){
+    calibration.bias[axis] = (int16_t) constrain(lround(calibration.bias[axis] * ratio), -32768L, 32767L);
+    calibration.noise[axis] = (uint16_t) constrain(lround(calibration.noise[axis] * ratio), 0L, 65535L);
+  }
+  calibration.scale = scaleRate;
+}
+
+void saveCalibration(){
+  uint8_t *bytes = (uint8_t *) &calibration;
+  uint8_t checksum = 0;
+
+  // only changed bytes, EEPROM cells wear out after about 100000 writes
+  for(uint8_t i = 0; i < sizeof(calibration); i++){
+    if(EEPROM.read(CALIBRATION_ADDRESS + i) != bytes[i]){
+      EEPROM.write(CALIBRATION_ADDRESS + i, bytes[i]);
+    }
+    checksum += bytes[i];
+  }
+  EEPROM.write(CALIBRATION_ADDRESS + sizeof(calibration), checksum);
+}
+
+void sendCalibration(uint8_t source){
+  uint16_t index = PACKET_HEADER;
+  output[index++] = source;
+  output[index++] = calibration.temperature;
+  for(uint8_t axis = 0; axis < 3; axis++){
+    index = insert(calibration.bias[axis], index);
+  }
+  for(uint8_t axis = 0; axis < 3; axis++){
+    index = insert(calibration.noise[axis], index);
+  }
+  index = insert(calibrationWindow, index);
+  sendPacket(PACKET_CALIBRATION, index);
+}
+
+void sendGyroSamples(uint8_t gyroCount, unsigned long elapsed){
+  uint16_t index = PACKET_HEADER;
+  uint16_t flagsIndex = index++;
+  uint8_t flags = 0;
+  index = insert((int16_t) elapsed, index);
+  output[index++] = gyroCount;
+
+  int16_t lastX = 0, lastY = 0, lastZ = 0;
+  for(uint8_t i = 0; i < gyroCount; i++){
+    readGyroSample(i);
+    if(i == 0){
+      index = insert(z, insert(y, insert(x, index)));
+    }
+    else {
+      index = insertDelta(z - lastZ, insertDelta(y - lastY, insertDelta(x - lastX, index)));
+    }
+    lastX = x;
+    lastY = y;
+    lastZ = z;
+  }
+
+  // the ADXL345 pops one FIFO entry per data register read, so every entry
+  // needs its own 6 byte transaction
+  uint8_t accelCount = (channels & PACKET_HAS_ACCEL) ? min(accel.getFIFOLength(), MAX_ACCEL_SAMPLES) : 0;
+  if(accelCount > 0){
+    flags |= PACKET_HAS_ACCEL;
+    output[index++] = accelCount;
+    for(uint8_t i = 0; i < accelCount; i++){
+      accel.getRawAcceleration(output + index);
+      index += 6;
+    }
+  }
+
+  // the magnetometer measures at 75 Hz, only send new measurements
+  if((channels & PACKET_HAS_MAG) && mag.getReadyStatus()){
+    flags |= PACKET_HAS_MAG;
+    mag.getHeading(&x,&y,&z);
+    index = insert(z, insert(y, insert(x, index)));
+  }
+
+  if((channels & PACKET_HAS_TEMP) && currentTime - tempTime >= TEMP_INTERVAL){
+    flags |= PACKET_HAS_TEMP;
+    output[index++] = gyro.getTemperature();
+    tempTime = currentTime;
+  }
+
+  output[flagsIndex] = flags;
+  sendPacket(PACKET_SAMPLES, index);
+}
+
+// Integrates every sample with q = q * (cos(a/2), axis * sin(a/2)), using
+// the small angle approximation sin(h) ~ h and cos(h) ~ 1 - h^2/2. The angle
+// is off by h^2/6, below 1e-4 at 2.5 degrees per sample (2000 dps, 800 Hz),
+// four times that per halving of the rate
+void sendOrientation(uint8_t gyroCount, unsigned long elapsed){
+  // half angle in Q30 radians per gyro LSB and sample, << HALF_ANGLE_SHIFT.
+  // Every FIFO sample covers 1 / ODR, as on the host; the packet interval
+  // is clamped and may be longer than the samples it carries
+  int32_t halfAngle = (int32_t) (gyroSensitivity() * (PI / 180.0) * 0.5 / gyroRate
+      * ((float) Q30_ONE * (1 << HALF_ANGLE_SHIFT)));
+
+  for(uint8_t i = 0; i < gyroCount; i++){
+    readGyroSample(i);
+    int32_t hx = mulHalfAngle(x, halfAngle);
+    int32_t hy = mulHalfAngle(y, halfAngle);
+    int32_t hz = mulHalfAngle(z, halfAngle);
+    int32_t hw = Q30_ONE - (q30Mul(hx, hx) + q30Mul(hy, hy) + q30Mul(hz, hz)) / 2;
+    orientation = orientation.getProduct(QuaternionQ30(hw, hx, hy, hz));
+  }
+  orientation.renormalize();
+
+  uint16_t index = PACKET_HEADER;
+  index = insert((int16_t) elapsed, index);
+  output[index++] = gyroCount;
+  index = insert32(orientation.w, index);
+  index = insert32(orientation.x, index);
+  index = insert32(orientation.y, index);
+  index = insert32(orientation.z, index);
+  index = insert(z, insert(y, insert(x, index)));
+  sendPacket(PACKET_ORIENTATION, index);
+}
+
+// (rate * halfAngle) >> HALF_ANGLE_SHIFT without an int64 multiply: the
+// product needs 34 bits at 100 Hz on the 2000 dps range, the split into the
+// integer and the fraction part of halfAngle is exact
+int32_t mulHalfAngle(int16_t rate, int32_t halfAngle){
+  return (int32_t) rate * (halfAngle >> HALF_ANGLE_SHIFT)
+      + (((int32_t) rate * (halfAngle & ((1 << HALF_ANGLE_SHIFT) - 1))) >> HALF_ANGLE_SHIFT);
+}
+
+// Degrees per second and gyro LSB
+float gyroSensitivity(){
+  return sensitivity(scaleRate);
+}
+
+float sensitivity(int16_t dps){
+  if(dps == 2000){
+    return 0.070;
+  }
+  else if(dps == 500){
+    return 0.0175;
+  }
+  return 0.00875;
+}
+
+void sendConfig(){
+  uint16_t index = PACKET_HEADER;
+  index = insert(scaleRate, index);
+  index = insert(gyroRate, index);
+  index = insert(ACCEL_RATE, index);
+  output[index++] = gyroBatch;
+  output[index++] = channels;
+  index = insert(gyroThreshHold, index);
+  output[index++] = hpfMode;
+  output[index++] = outputMode;
+  sendPacket(PACKET_CONFIG, index);
+  configTime = micros();
+}
+
+// Collects the bytes of a command packet and handles it once complete,
+// a broken command is dropped and repeated by the host
+void receiveCommands(){
+  while(Serial.available() > 0){
+    uint8_t c = Serial.read();
+
+    if(commandLength == 0 && c != PACKET_SYNC){
+      continue;
+    }
+    command[commandLength++] = c;
+
+    if(commandLength == PACKET_HEADER && command[2] > MAX_COMMAND_PAYLOAD){
+      commandLength = 0;
+    }
+    else if(commandLength > PACKET_HEADER && commandLength == PACKET_HEADER + command[2] + 1){
+      uint8_t checksum = 0;
+      for(uint8_t i = 1; i < commandLength - 1; i++){
+        checksum += command[i];
+      }
+      if(checksum == command[commandLength - 1]){
+        handleCommand(command[1], command + PACKET_HEADER, command[2]);
+      }
+      commandLength = 0;
+    }
+  }
+}
+
+void handleCommand(uint8_t type, uint8_t *payload, uint8_t length){
+  uint8_t status = ACK_INVALID;
+  int16_t value = length >= 2 ? convert(payload) : (length == 1 ? payload[0] : -1);
+
+  switch(type){
+    case CMD_QUERY:
+      sendCapabilities();
+      return;
+    case CMD_SET_RATE:
+      if(setGyroRate(value)){
+        status = ACK_OK;
+      }
+      break;
+    case CMD_SET_SCALE:
+      if(setGyroScale(value)){
+        status = ACK_OK;
+      }
+      break;
+    case CMD_SET_WATERMARK:
+      if(value >= 1 && value <= MAX_GYRO_SAMPLES){
+        gyroBatch = value;
+        status = ACK_OK;
+      }
+      break;
+    case CMD_SET_CHANNELS:
+      if(value >= 0 && (value & ~ALL_CHANNELS) == 0){
+        channels = value;
+        status = ACK_OK;
+      }
+      break;
+    case CMD_SET_THRESHOLD:
+      if(value >= 0){
+        gyroThreshHold = value;
+        status = ACK_OK;
+      }
+      break;
+    case CMD_SET_HPF:
+      if(value >= L3G4200D_HPF_MODE_NORMAL_RESET && value <= L3G4200D_HPF_MODE_AUTORESET_INTERRUPT){
+        hpfMode = value;
+        gyro.setHPFMode(hpfMode);
+        status = ACK_OK;
+      }
+      break;
+    case CMD_CALIBRATE:
+      if(value == 0 || value >= 2){
+        startCalibration(value == 0 ? CALIBRATION_WINDOW : value);
+        status = ACK_OK;
+      }
+      break;
+    case CMD_SET_MODE:
+      if(value == MODE_SAMPLES || value == MODE_ORIENTATION){
+        outputMode = value;
+        orientation = QuaternionQ30();
+        status = ACK_OK;
+      }
+      break;
+    default:
+      status = ACK_UNKNOWN;
+  }
+
+  uint16_t index = PACKET_HEADER;
+  output[index++] = type;
+  output[index++] = status;
+  sendPacket(PACKET_ACK, index);
+
+  if(status == ACK_OK){
+    sendConfig();
+  }
+}
+
+void sendCapabilities(){
+  uint16_t index = PACKET_HEADER;
+  output[index++] = PROTOCOL_VERSION;
+  output[index++] = RATE_100 | RATE_200 | RATE_400 | RATE_800;
+  output[index++] = SCALE_250 | SCALE_500 | SCALE_2000;
+  output[index++] = MAX_GYRO_SAMPLES;
+  output[index++] = ALL_CHANNELS;
+  output[index++] = (1 << MODE_SAMPLES) | (1 << MODE_ORIENTATION);
+  index = insert(setupTransactions, index);
+  index = insert(setupSavedTransactions, index);
+  sendPacket(PACKET_CAPABILITIES, index);
+}
+
+bool setGyroRate(int16_t rate){
+  uint8_t drbw;
+
+  if(rate == 100){
+    drbw = L3G4200D_DR_BW_RATE_ODR100_CO25_0;
+  }
+  else if(rate == 200){
+    drbw = L3G4200D_DR_BW_RATE_ODR200_CO50;
+  }
+  else if(rate == 400){
+    drbw = L3G4200D_DR_BW_RATE_ODR400_CO50;
+  }
+  else if(rate == 800){
+    drbw = L3G4200D_DR_BW_RATE_ODR800_CO30;
+  }
+  else {
+    return false;
+  }
+
+  gyroRate = rate;
+  gyro.setDRBWRate(drbw);
+  restartFIFO();
+  return true;
+}
+
+bool setGyroScale(int16_t dps){
+  if(dps == 2000){
+    gyro.setScale(L3G4200D_SCALE_RATE_2000DPS);
+  }
+  else if(dps == 500){
+    gyro.setScale(L3G4200D_SCALE_RATE_500DPS);
+  }
+  else if(dps == 250){
+    gyro.setScale(L3G4200D_SCALE_RATE_250DPS);
+  }
+  else {
+    return false;
+  }
+
+  int16_t previous = scaleRate;
+  scaleRate = dps;
+  // queued samples have the old scale
+  restartFIFO();
+
+  // bias, noise and threshold are in LSB of the scale
+  if(calibrating){
+    startCalibration(calibrationWindow);
+  }
+  else {
+    // keeps a threshold set by the host
+    int16_t threshold = (int16_t) lround(gyroThreshHold * sensitivity(previous) / gyroSensitivity());
+    rescaleCalibration();
+    applyCalibration();
+    gyroThreshHold = threshold;
+  }
+  return true;
+}
+
+// Drops the queued gyro samples and their data ready times
+void restartFIFO(){
+  gyro.setFIFOMode(L3G4200D_FIFO_CTRL_MODE_BYPASS);
+  gyro.setFIFOMode(L3G4200D_FIFO_CTRL_MODE_STREAM);
+  drdyTail = drdyHead;
+  prevTime = micros();
+}
+
+// Frames the payload in output[PACKET_HEADER, end) and sends it
+void sendPacket(uint8_t type, uint16_t end){
+  output[0] = PACKET_SYNC;
+  output[1] = type;
+  output[2] = end - PACKET_HEADER;
+
+  uint8_t checksum = 0;
+  for(uint16_t i = 1; i < end; i++){
+    checksum += output[i];
+  }
+  output[end++] = checksum;
+
+  Serial.write(output, end);
+}
+
+void setupAccel(){
+  accel.setRate(ADXL345_RATE_100);
+}
+
+void setupMag(){
+  mag.setDataRate(HMC5883L_RATE_75);
+  mag.setMode(HMC5883L_MODE_CONTINUOUS);
+}
+
+void setupFIFO(){
+  gyro.setFIFOMode(L3G4200D_FIFO_CTRL_MODE_STREAM);
+  gyro.setFIFOEnabled(true);
+  accel.setFIFOMode(ADXL345_FIFO_MODE_STREAM);
+}
+
 void setupGyro(){
   gyro.setPowerMode(L3G4200D_POWERMODE_NORMAL);
   gyro.setDRDYInterrupt(true);
   gyro.setScale(L3G4200D_SCALE_RATE_2000DPS);
   gyro.setDRBWRate(L3G4200D_DR_BW_RATE_ODR800_CO30); 
-  gyro.setHPFMode(L3G4200D_HPF_MODE_NORMAL);
+  gyro.setHPFMode(hpfMode);
   gyro.setOutHighLowFiltered();
 
   if(gyro.getScale() == L3G4200D_SCALE_RATE_2000DPS){
-    convertAndInsert(2000, 18);
+    scaleRate = 2000;
   }
   else if (gyro.getScale() == L3G4200D_SCALE_RATE_500DPS){
-    convertAndInsert(500, 18);
-  }
-  else if (gyro.getScale() == L3G4200D_SCALE_RATE_250DPS){
-    convertAndInsert(250, 18);
-  }
-  /*
-  if(gyro.getDataRate() == L3G4200D_DR_RATE_800){
-   convertAndInsert(800, 20);
-   }
-   else if(gyro.getDataRate() == L3G4200D_DR_RATE_400){
-   convertAndInsert(400, 20);
-   }
-   else if(gyro.getDataRate() == L3G4200D_DR_RATE_200){
-   convertAndInsert(200, 20);
-   }
-   else if(gyro.getDataRate() == L3G4200D_DR_RATE_100){
-   convertAndInsert(100, 20);
-   }
-   */
-
-}
-
-void convertAndInsert(int16_t value, uint8_t index ){
-  output[index]   = value % 256 ;
-  output[index+1] = value / 256;
+    scaleRate = 500;
+  }
+  else {
+    scaleRate = 250;
+  }
+
+}
+
+uint16_t insert(int16_t value, uint16_t index){
+  output[index]   = value & 0xFF;
+  output[index+1] = (value >> 8) & 0xFF;
+  return index + 2;
+}
+
+uint16_t insert32(int32_t value, uint16_t index){
+  return insert((int16_t) (value >> 16), insert((int16_t) (value & 0xFFFF), index));
+}
+
+uint16_t insertDelta(int16_t delta, uint16_t index){
+  if(delta > DELTA_ESCAPE && delta <= 127){
+    output[index] = (uint8_t) delta;
+    return index + 1;
+  }
+  output[index] = (uint8_t) DELTA_ESCAPE;
+  return insert(delta, index + 1);
+}
+
+int16_t convert(uint8_t *lsb){
+  return (int16_t) (lsb[0] | (lsb[1] << 8));
 }
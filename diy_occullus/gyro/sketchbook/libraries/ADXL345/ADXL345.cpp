@@ -60,6 +60,21 @@ void ADXL345::initialize() {
     setMeasureEnabled(true);
 }
 
+/** Let I2Cdev keep a copy of the configuration registers.
+ * Bit field setters then need a single write instead of a read and a write.
+ * Call it before initialize(), which writes every register it caches.
+ * Status, interrupt source, data and FIFO status are volatile.
+ */
+void ADXL345::enableRegisterCache() {
+#ifdef I2CDEV_REGISTER_CACHE
+    I2Cdev::setVolatileRegisters(devAddr, ADXL345_RA_ACT_TAP_STATUS, ADXL345_RA_ACT_TAP_STATUS);
+    I2Cdev::setVolatileRegisters(devAddr, ADXL345_RA_INT_SOURCE, ADXL345_RA_INT_SOURCE);
+    I2Cdev::setVolatileRegisters(devAddr, ADXL345_RA_DATAX0, ADXL345_RA_DATAZ1);
+    I2Cdev::setVolatileRegisters(devAddr, ADXL345_RA_FIFO_STATUS, ADXL345_RA_FIFO_STATUS);
+    I2Cdev::enableRegisterCache(devAddr);
+#endif
+}
+
 /** Verify the I2C connection.
  * Make sure the device is connected and responds as expected.
  * @return True if connection is valid, false otherwise
@@ -1662,11 +1677,11 @@ bool ADXL345::getFIFOTriggerOccurred() {
  * available at any given time because an additional entry is available at the
  * output filter of the I2Cdev::
  * @return Current FIFO length
- * @see ADXL345_RA_FIFO_CTL
+ * @see ADXL345_RA_FIFO_STATUS
  * @see ADXL345_FIFOSTAT_LENGTH_BIT
  * @see ADXL345_FIFOSTAT_LENGTH_LENGTH
  */
 uint8_t ADXL345::getFIFOLength() {
-    I2Cdev::readBits(devAddr, ADXL345_RA_FIFO_CTL, ADXL345_FIFOSTAT_LENGTH_BIT, ADXL345_FIFOSTAT_LENGTH_LENGTH, buffer);
+    I2Cdev::readBits(devAddr, ADXL345_RA_FIFO_STATUS, ADXL345_FIFOSTAT_LENGTH_BIT, ADXL345_FIFOSTAT_LENGTH_LENGTH, buffer);
     return buffer[0];
 }
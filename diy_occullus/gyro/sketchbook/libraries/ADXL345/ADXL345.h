@@ -170,6 +170,7 @@ class ADXL345 {
 
         void initialize();
         bool testConnection();
+        void enableRegisterCache();
 
         // DEVID register
         uint8_t getDeviceID();
@@ -72,6 +72,19 @@ void HMC5883L::initialize() {
     setMode(HMC5883L_MODE_SINGLE);
 }
 
+/** Let I2Cdev keep a copy of the configuration registers.
+ * Bit field setters then need a single write instead of a read and a write.
+ * Call it before initialize(), which writes every register it caches.
+ * Data, status and ID are volatile, and so is the mode: a single measurement
+ * returns it to idle.
+ */
+void HMC5883L::enableRegisterCache() {
+#ifdef I2CDEV_REGISTER_CACHE
+    I2Cdev::setVolatileRegisters(devAddr, HMC5883L_RA_MODE, HMC5883L_RA_ID_C);
+    I2Cdev::enableRegisterCache(devAddr);
+#endif
+}
+
 /** Verify the I2C connection.
  * Make sure the device is connected and responds as expected.
  * @return True if connection is valid, false otherwise
@@ -107,6 +107,7 @@ class HMC5883L {
         
         void initialize();
         bool testConnection();
+        void enableRegisterCache();
 
         // CONFIG_A register
         uint8_t getSampleAveraging();
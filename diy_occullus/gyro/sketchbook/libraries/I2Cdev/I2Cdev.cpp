@@ -206,6 +206,9 @@ int8_t I2Cdev::readWord(uint8_t devAddr, uint8_t regAddr, uint16_t *data, uint16
  * @return Number of bytes read (-1 indicates failure)
  */
 int8_t I2Cdev::readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data, uint16_t timeout) {
+    #ifdef I2CDEV_REGISTER_CACHE
+        transactions++;
+    #endif
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.print("I2C (0x");
         Serial.print(devAddr, HEX);
@@ -316,6 +319,9 @@ int8_t I2Cdev::readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8
         Serial.println(" read).");
     #endif
 
+    #ifdef I2CDEV_REGISTER_CACHE
+        if (length == 1 && count == 1) cacheRegister(devAddr, regAddr, data[0]);
+    #endif
     return count;
 }
 
@@ -328,6 +334,9 @@ int8_t I2Cdev::readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8
  * @return Number of words read (0 indicates failure)
  */
 int8_t I2Cdev::readWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16_t *data, uint16_t timeout) {
+    #ifdef I2CDEV_REGISTER_CACHE
+        transactions++;
+    #endif
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.print("I2C (0x");
         Serial.print(devAddr, HEX);
@@ -480,7 +489,11 @@ int8_t I2Cdev::readWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint1
  */
 bool I2Cdev::writeBit(uint8_t devAddr, uint8_t regAddr, uint8_t bitNum, uint8_t data) {
     uint8_t b;
-    readByte(devAddr, regAddr, &b);
+    #ifdef I2CDEV_REGISTER_CACHE
+        readCachedByte(devAddr, regAddr, &b);
+    #else
+        readByte(devAddr, regAddr, &b);
+    #endif
     b = (data != 0) ? (b | (1 << bitNum)) : (b & ~(1 << bitNum));
     return writeByte(devAddr, regAddr, b);
 }
@@ -516,7 +529,12 @@ bool I2Cdev::writeBits(uint8_t devAddr, uint8_t regAddr, uint8_t bitStart, uint8
     // 10100011 original & ~mask
     // 10101011 masked | value
     uint8_t b;
-    if (readByte(devAddr, regAddr, &b) != 0) {
+    #ifdef I2CDEV_REGISTER_CACHE
+        int8_t count = readCachedByte(devAddr, regAddr, &b);
+    #else
+        int8_t count = readByte(devAddr, regAddr, &b);
+    #endif
+    if (count != 0) {
         uint8_t mask = ((1 << length) - 1) << (bitStart - length + 1);
         data <<= (bitStart - length + 1); // shift data into correct position
         data &= mask; // zero all non-important bits in data
@@ -585,6 +603,9 @@ bool I2Cdev::writeWord(uint8_t devAddr, uint8_t regAddr, uint16_t data) {
  * @return Status of operation (true = success)
  */
 bool I2Cdev::writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t* data) {
+    #ifdef I2CDEV_REGISTER_CACHE
+        transactions++;
+    #endif
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.print("I2C (0x");
         Serial.print(devAddr, HEX);
@@ -624,6 +645,10 @@ bool I2Cdev::writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.println(". Done.");
     #endif
+    #ifdef I2CDEV_REGISTER_CACHE
+        if (length == 1 && status == 0) cacheRegister(devAddr, regAddr, data[0]);
+        else uncacheRegisters(devAddr, regAddr, length);
+    #endif
     return status == 0;
 }
 
@@ -635,6 +660,9 @@ bool I2Cdev::writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_
  * @return Status of operation (true = success)
  */
 bool I2Cdev::writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16_t* data) {
+    #ifdef I2CDEV_REGISTER_CACHE
+        transactions++;
+    #endif
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.print("I2C (0x");
         Serial.print(devAddr, HEX);
@@ -676,6 +704,9 @@ bool I2Cdev::writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.println(". Done.");
     #endif
+    #ifdef I2CDEV_REGISTER_CACHE
+        uncacheRegisters(devAddr, regAddr, length * 2);
+    #endif
     return status == 0;
 }
 
@@ -684,6 +715,121 @@ bool I2Cdev::writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16
  */
 uint16_t I2Cdev::readTimeout = I2CDEV_DEFAULT_READ_TIMEOUT;
 
+#ifdef I2CDEV_REGISTER_CACHE
+    /** Bus transactions (reads and writes) since startup.
+     */
+    uint16_t I2Cdev::transactions = 0;
+
+    /** Register reads served from the cache instead of the bus.
+     */
+    uint16_t I2Cdev::savedTransactions = 0;
+
+    uint8_t I2Cdev::cachedDevices[I2CDEV_CACHED_DEVICES];
+    uint8_t I2Cdev::volatileRanges[I2CDEV_VOLATILE_RANGES][3];
+    uint8_t I2Cdev::cacheDevAddr[I2CDEV_REGISTER_CACHE_SIZE];
+    uint8_t I2Cdev::cacheRegAddr[I2CDEV_REGISTER_CACHE_SIZE];
+    uint8_t I2Cdev::cacheData[I2CDEV_REGISTER_CACHE_SIZE];
+    uint8_t I2Cdev::cacheNext = 0;
+
+    /** Keep a shadow copy of the registers of a device.
+     * Every single byte read or written register of the device is remembered,
+     * writeBit() and writeBits() then modify the copy instead of reading the
+     * register first. Declare the registers the device changes by itself (data,
+     * status, self clearing bits) with setVolatileRegisters() first. Address 0
+     * (general call) is never a device and marks free slots.
+     * @param devAddr I2C slave device address
+     */
+    void I2Cdev::enableRegisterCache(uint8_t devAddr) {
+        for (uint8_t i = 0; i < I2CDEV_CACHED_DEVICES; i++) {
+            if (cachedDevices[i] == devAddr) return;
+            if (cachedDevices[i] == 0) {
+                cachedDevices[i] = devAddr;
+                return;
+            }
+        }
+    }
+
+    /** Exclude registers from the cache, writeBit(s) always reads them.
+     * @param devAddr I2C slave device address
+     * @param firstReg First volatile register
+     * @param lastReg Last volatile register (inclusive)
+     */
+    void I2Cdev::setVolatileRegisters(uint8_t devAddr, uint8_t firstReg, uint8_t lastReg) {
+        for (uint8_t i = 0; i < I2CDEV_VOLATILE_RANGES; i++) {
+            if (volatileRanges[i][0] == 0) {
+                volatileRanges[i][0] = devAddr;
+                volatileRanges[i][1] = firstReg;
+                volatileRanges[i][2] = lastReg;
+                break;
+            }
+        }
+        uncacheRegisters(devAddr, firstReg, lastReg - firstReg + 1);
+    }
+
+    /** Forget the cached registers of a device, after it was reset.
+     * @param devAddr I2C slave device address
+     */
+    void I2Cdev::invalidateRegisterCache(uint8_t devAddr) {
+        for (uint8_t i = 0; i < I2CDEV_REGISTER_CACHE_SIZE; i++) {
+            if (cacheDevAddr[i] == devAddr) cacheDevAddr[i] = 0;
+        }
+    }
+
+    bool I2Cdev::isCacheable(uint8_t devAddr, uint8_t regAddr) {
+        bool enabled = false;
+        for (uint8_t i = 0; i < I2CDEV_CACHED_DEVICES; i++) {
+            if (cachedDevices[i] == devAddr) enabled = true;
+        }
+        if (!enabled) return false;
+        for (uint8_t i = 0; i < I2CDEV_VOLATILE_RANGES; i++) {
+            if (volatileRanges[i][0] == devAddr && regAddr >= volatileRanges[i][1] && regAddr <= volatileRanges[i][2]) return false;
+        }
+        return true;
+    }
+
+    int8_t I2Cdev::findCachedRegister(uint8_t devAddr, uint8_t regAddr) {
+        for (uint8_t i = 0; i < I2CDEV_REGISTER_CACHE_SIZE; i++) {
+            if (cacheDevAddr[i] == devAddr && cacheRegAddr[i] == regAddr) return i;
+        }
+        return -1;
+    }
+
+    void I2Cdev::cacheRegister(uint8_t devAddr, uint8_t regAddr, uint8_t data) {
+        if (!isCacheable(devAddr, regAddr)) return;
+        int8_t i = findCachedRegister(devAddr, regAddr);
+        if (i < 0) {
+            // full: replace the slots in turn, setup touches each register a few times at most
+            i = cacheNext;
+            cacheNext = (cacheNext + 1) % I2CDEV_REGISTER_CACHE_SIZE;
+        }
+        cacheDevAddr[i] = devAddr;
+        cacheRegAddr[i] = regAddr;
+        cacheData[i] = data;
+    }
+
+    void I2Cdev::uncacheRegisters(uint8_t devAddr, uint8_t regAddr, uint8_t length) {
+        // multi byte transfers may use an auto increment flag in the address
+        // (L3G4200D bit 7), drop the range with and without it
+        for (uint8_t i = 0; i < I2CDEV_REGISTER_CACHE_SIZE; i++) {
+            uint8_t offset = (cacheRegAddr[i] - regAddr) & 0x7F;
+            if (cacheDevAddr[i] == devAddr && offset < length) cacheDevAddr[i] = 0;
+        }
+    }
+
+    /** Read a register for read-modify-write, from the cache if possible.
+     * @return Status of read operation, as readByte()
+     */
+    int8_t I2Cdev::readCachedByte(uint8_t devAddr, uint8_t regAddr, uint8_t *data) {
+        int8_t i = findCachedRegister(devAddr, regAddr);
+        if (i >= 0) {
+            *data = cacheData[i];
+            savedTransactions++;
+            return 1;
+        }
+        return readByte(devAddr, regAddr, data);
+    }
+#endif
+
 #if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_FASTWIRE
     /*
     FastWire 0.2
@@ -70,6 +70,16 @@ THE SOFTWARE.
 // -----------------------------------------------------------------------------
 //#define I2CDEV_SERIAL_DEBUG
 
+// -----------------------------------------------------------------------------
+// Register shadow cache, lets writeBit(s) skip the read of read-modify-write
+// for devices that enable it (uncomment to enable, costs about 100 bytes of
+// RAM; a register that changes behind the cache's back reads stale)
+// -----------------------------------------------------------------------------
+//#define I2CDEV_REGISTER_CACHE
+#define I2CDEV_REGISTER_CACHE_SIZE      24 // registers of all devices together
+#define I2CDEV_VOLATILE_RANGES          10 // register ranges of all devices together
+#define I2CDEV_CACHED_DEVICES           4
+
 #ifdef ARDUINO
     #if ARDUINO < 100
         #include "WProgram.h"
@@ -109,6 +119,29 @@ class I2Cdev {
         static bool writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16_t *data);
 
         static uint16_t readTimeout;
+
+        #ifdef I2CDEV_REGISTER_CACHE
+            static void enableRegisterCache(uint8_t devAddr);
+            static void setVolatileRegisters(uint8_t devAddr, uint8_t firstReg, uint8_t lastReg);
+            static void invalidateRegisterCache(uint8_t devAddr);
+
+            static uint16_t transactions;
+            static uint16_t savedTransactions;
+
+        private:
+            static bool isCacheable(uint8_t devAddr, uint8_t regAddr);
+            static int8_t findCachedRegister(uint8_t devAddr, uint8_t regAddr);
+            static void cacheRegister(uint8_t devAddr, uint8_t regAddr, uint8_t data);
+            static void uncacheRegisters(uint8_t devAddr, uint8_t regAddr, uint8_t length);
+            static int8_t readCachedByte(uint8_t devAddr, uint8_t regAddr, uint8_t *data);
+
+            static uint8_t cachedDevices[I2CDEV_CACHED_DEVICES];
+            static uint8_t volatileRanges[I2CDEV_VOLATILE_RANGES][3];
+            static uint8_t cacheDevAddr[I2CDEV_REGISTER_CACHE_SIZE];
+            static uint8_t cacheRegAddr[I2CDEV_REGISTER_CACHE_SIZE];
+            static uint8_t cacheData[I2CDEV_REGISTER_CACHE_SIZE];
+            static uint8_t cacheNext;
+        #endif
 };
 
 #if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_FASTWIRE
@@ -195,6 +195,21 @@ void L3G4200D::initialize() {
     I2Cdev::writeByte(devAddr, L3G4200D_RA_INT1_DURATION, 0b00000000);  
 }
 
+/** Let I2Cdev keep a copy of the configuration registers.
+ * Bit field setters then need a single write instead of a read and a write.
+ * Call it before initialize(), which writes every register it caches.
+ * Temperature, status, data and the FIFO and interrupt sources are volatile.
+ * The BOOT bit of CTRL_REG5 clears itself: invalidate the cache after a reboot.
+ */
+void L3G4200D::enableRegisterCache() {
+#ifdef I2CDEV_REGISTER_CACHE
+    I2Cdev::setVolatileRegisters(devAddr, L3G4200D_RA_OUT_TEMP, L3G4200D_RA_OUT_Z_H);
+    I2Cdev::setVolatileRegisters(devAddr, L3G4200D_RA_FIFO_SRC_REG, L3G4200D_RA_FIFO_SRC_REG);
+    I2Cdev::setVolatileRegisters(devAddr, L3G4200D_RA_INT1_SRC, L3G4200D_RA_INT1_SRC);
+    I2Cdev::enableRegisterCache(devAddr);
+#endif
+}
+
 /** Verify the I2C connection.
  * Make sure the device is connected and responds as expected.
  * @return True if connection is valid, false otherwise
@@ -256,6 +271,16 @@ int16_t L3G4200D::getRoll(){
 	return (msb << 8) | lsb;
 }
 
+/** Get the die temperature.
+ * Not calibrated: -1 LSB per degree C with a part specific offset, good for
+ * comparing temperatures of the same sensor only.
+ * @return Raw temperature
+ * @see L3G4200D_RA_OUT_TEMP
+ */
+int8_t L3G4200D::getTemperature(){
+    I2Cdev::readByte(devAddr, L3G4200D_RA_OUT_TEMP, buffer);
+    return (int8_t) buffer[0];
+}
 
 void L3G4200D::reset(){
 
@@ -279,6 +304,39 @@ void L3G4200D::setFIFOMode(uint8_t mode){
     I2Cdev::writeBits(devAddr, L3G4200D_RA_FIFO_CTRL_REG ,L3G4200D_FIFO_CTRL_MODE_BIT, L3G4200D_FIFO_CTRL_MODE_LENGTH ,mode);
 }
 
+/** Get the number of samples stored in the FIFO.
+ * A full FIFO reports 31 stored samples and the overrun flag, which counts as 32.
+ * @return Samples ready to be read with getFIFORotations()
+ * @see L3G4200D_RA_FIFO_SRC_REG
+ */
+uint8_t L3G4200D::getFIFOLength(){
+    I2Cdev::readByte(devAddr, L3G4200D_RA_FIFO_SRC_REG, buffer);
+    if (buffer[0] & (1 << L3G4200D_FIFO_SRC_OVRN_BIT))
+        return L3G4200D_FIFO_SIZE;
+    return buffer[0] & ((1 << L3G4200D_FIFO_SRC_FSS_LENGTH) - 1);
+}
+
+/** Burst read samples from the FIFO.
+ * Each sample is 6 bytes, X, Y and Z rotation with the low byte first. Up to
+ * L3G4200D_FIFO_BURST_SAMPLES samples are read per I2C transaction instead of
+ * one transaction per register.
+ * @param _buffer Receives count * 6 bytes
+ * @param count Samples to read, at most getFIFOLength()
+ * @return Samples read
+ */
+uint8_t L3G4200D::getFIFORotations(uint8_t *_buffer, uint8_t count){
+    uint8_t read = 0;
+
+    while (read < count) {
+        uint8_t samples = min(count - read, L3G4200D_FIFO_BURST_SAMPLES);
+        if (I2Cdev::readBytes(devAddr, L3G4200D_RA_OUT_X_L | L3G4200D_AUTO_INCREMENT, samples * 6, _buffer + read * 6) != samples * 6)
+            break;
+        read += samples;
+    }
+
+    return read;
+}
+
 uint8_t L3G4200D::getDataRate(){
     I2Cdev::readBits(devAddr, L3G4200D_RA_CTRL_REG1, L3G4200D_DR_RATE_BIT, L3G4200D_DR_RATE_LENGTH, buffer);
     return buffer[0];
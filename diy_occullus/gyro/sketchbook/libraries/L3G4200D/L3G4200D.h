@@ -214,6 +214,16 @@ THE SOFTWARE.
 #define L3G4200D_FIFO_CTRL_MODE_BIT	    7
 #define L3G4200D_FIFO_CTRL_MODE_LENGTH	3
 
+#define L3G4200D_FIFO_SRC_WTM_BIT	    7
+#define L3G4200D_FIFO_SRC_OVRN_BIT	    6
+#define L3G4200D_FIFO_SRC_EMPTY_BIT	    5
+#define L3G4200D_FIFO_SRC_FSS_BIT	    4
+#define L3G4200D_FIFO_SRC_FSS_LENGTH	5
+
+// Set in the register address of a multi byte read to increment the address,
+// with the FIFO enabled the address wraps from OUT_Z_H back to OUT_X_L
+#define L3G4200D_AUTO_INCREMENT		    0x80
+
 
 
 
@@ -315,6 +325,10 @@ THE SOFTWARE.
 #define L3G4200D_FIFO_CTRL_MODE_STREAMTOFIFO	0b011
 #define L3G4200D_FIFO_CTRL_MODE_BYPASSTOSTREAM	0b100
 
+#define L3G4200D_FIFO_SIZE			            32
+// Samples per I2C transaction, limited by the 32 byte Wire buffer
+#define L3G4200D_FIFO_BURST_SAMPLES		        5
+
 
 
 class L3G4200D {
@@ -324,6 +338,7 @@ class L3G4200D {
 
         void initialize();
         bool testConnection();
+        void enableRegisterCache();
 
 	    uint8_t getDeviceID();
 
@@ -332,6 +347,7 @@ class L3G4200D {
         int16_t getPitch();
         int16_t getYaw();
         int16_t getRoll();
+        int8_t getTemperature();
 
 
         void reset();               
@@ -339,6 +355,8 @@ class L3G4200D {
         void setFIFOEnabled(bool enabled);
 	    uint8_t getFIFOMode();
 	    void setFIFOMode(uint8_t mode);
+        uint8_t getFIFOLength();
+        uint8_t getFIFORotations(uint8_t *_buffer, uint8_t count);
 
         uint8_t getDataRate();
         void setDataRate(uint8_t rate);
@@ -111,6 +111,11 @@ MPU6050 mpu;
 // format used for the InvenSense teapot demo
 #define OUTPUT_TEAPOT
 
+// uncomment "DMP_WARM_START" to keep the DMP code that is still loaded after
+// a reset of the Arduino alone (the MPU6050 stayed powered): the code is
+// compared instead of uploaded, only banks that differ are written again
+//#define DMP_WARM_START
+
 
 
 #define LED_PIN 13 // (Arduino is 13, Teensy is 11, Teensy++ is 6)
@@ -118,6 +123,11 @@ bool blinkState = false;
 
 // MPU control/status vars
 bool dmpReady = false;  // set true if DMP init was successful
+
+// boot timing vars
+unsigned long waitTime;         // [ms] spent waiting for the start character
+unsigned long dmpTime;          // [ms] spent in dmpInitialize()
+bool firstPacket = true;        // boot time not reported yet
 uint8_t mpuIntStatus;   // holds actual interrupt status byte from MPU
 uint8_t devStatus;      // return status after each device operation (0 = success, !0 = error)
 uint16_t packetSize;    // expected DMP packet size (default is 42 bytes)
@@ -156,6 +166,7 @@ void dmpDataReady() {
 void setup() {
     // join I2C bus (I2Cdev library doesn't do this automatically)
     Wire.begin();
+    TWBR = 24; // 400kHz I2C clock (200kHz if CPU is 8MHz), the MPU6050 supports fast mode
 
     // initialize serial communication
     // (115200 chosen because it is required for Teapot Demo output, but it's
@@ -179,13 +190,21 @@ void setup() {
 
     // wait for ready
     Serial.println(F("\nSend any character to begin DMP programming and demo: "));
+    waitTime = millis();
     while (Serial.available() && Serial.read()); // empty buffer
     while (!Serial.available());                 // wait for data
     while (Serial.available() && Serial.read()); // empty buffer again
+    waitTime = millis() - waitTime;
 
     // load and configure the DMP
     Serial.println(F("Initializing DMP..."));
-    devStatus = mpu.dmpInitialize();
+    dmpTime = millis();
+    #ifdef DMP_WARM_START
+        devStatus = mpu.dmpInitialize(true);
+    #else
+        devStatus = mpu.dmpInitialize();
+    #endif
+    dmpTime = millis() - dmpTime;
     
     // make sure it worked (returns 0 if so)
     if (devStatus == 0) {
@@ -262,6 +281,16 @@ void loop() {
 
         // read a packet from FIFO
         mpu.getFIFOBytes(fifoBuffer, packetSize);
+
+        if (firstPacket) {
+            // time from reset to the first quaternion, without the wait for the start character
+            firstPacket = false;
+            Serial.print(F("First quaternion "));
+            Serial.print(millis() - waitTime);
+            Serial.print(F(" ms after boot, "));
+            Serial.print(dmpTime);
+            Serial.println(F(" ms of it in dmpInitialize()"));
+        }
         
         // track FIFO count here in case there is > 1 packet available
         // (this lets us immediately read more without waiting for an interrupt)
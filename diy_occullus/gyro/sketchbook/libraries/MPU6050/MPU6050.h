@@ -396,6 +396,14 @@ THE SOFTWARE.
 #define MPU6050_DMP_MEMORY_BANK_SIZE    256
 #define MPU6050_DMP_MEMORY_CHUNK_SIZE   16
 
+// Bytes per block transfer: the Arduino Wire buffer (BUFFER_LENGTH, 32) holds
+// the MEM_R_W register address and the data of one transaction
+#if I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE && defined(BUFFER_LENGTH)
+    #define MPU6050_DMP_MEMORY_BURST_SIZE   (BUFFER_LENGTH - 1)
+#else
+    #define MPU6050_DMP_MEMORY_BURST_SIZE   MPU6050_DMP_MEMORY_CHUNK_SIZE
+#endif
+
 // note: DMP code memory blocks defined at end of header file
 
 class MPU6050 {
@@ -781,7 +789,7 @@ class MPU6050 {
             uint8_t *dmpPacketBuffer;
             uint16_t dmpPacketSize;
 
-            uint8_t dmpInitialize();
+            uint8_t dmpInitialize(bool warmStart=false);
             bool dmpPacketAvailable();
 
             uint8_t dmpSetFIFORate(uint8_t fifoRate);
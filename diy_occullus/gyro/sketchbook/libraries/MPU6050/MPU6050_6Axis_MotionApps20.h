@@ -72,6 +72,12 @@ THE SOFTWARE.
 #define MPU6050_DMP_CODE_SIZE       1929    // dmpMemory[]
 #define MPU6050_DMP_CONFIG_SIZE     192     // dmpConfig[]
 #define MPU6050_DMP_UPDATES_SIZE    47      // dmpUpdates[]
+// Memory update 6/7 is read back, not written
+#define MPU6050_DMP_UPDATE_READ     5
+
+// FIFO packet of the dmpConfig[] above: quaternion (CFG_8, 4 x 32 bit),
+// gyro (CFG_9, 3 x 32 bit), accel (CFG_12, 3 x 32 bit) and the footer
+#define MPU6050_DMP_PACKET_SIZE     (4 * 4 + 3 * 4 + 3 * 4 + 2)
 
 /* ================================================================================================ *
  | Default MotionApps v2.0 42-byte FIFO packet structure:                                           |
@@ -278,11 +284,88 @@ const unsigned char dmpUpdates[MPU6050_DMP_UPDATES_SIZE] PROGMEM = {
     0x00,   0x60,   0x04,   0x00, 0x40, 0x00, 0x00
 };
 
-uint8_t MPU6050::dmpInitialize() {
-    // reset device
-    DEBUG_PRINTLN(F("\n\nResetting MPU6050..."));
-    reset();
-    delay(30); // wait after reset
+// Marks the bytes of one bank that a set of [bank] [offset] [length] [data]
+// blocks writes, except block skip. A length of 0 is a special instruction
+// with one byte of data.
+static void dmpMarkWritten(const unsigned char *set, uint16_t size, uint8_t bank, uint8_t skip, uint8_t *written) {
+    uint8_t block = 0;
+    for (uint16_t i = 0; i < size; block++) {
+        uint8_t blockBank = pgm_read_byte(set + i);
+        uint8_t offset = pgm_read_byte(set + i + 1);
+        uint8_t length = pgm_read_byte(set + i + 2);
+        i += 3;
+        if (length == 0) {
+            i++;
+            continue;
+        }
+        if (blockBank == bank && block != skip) {
+            for (uint16_t a = offset; a < offset + length && a < MPU6050_DMP_MEMORY_BANK_SIZE; a++) {
+                written[a >> 3] |= 1 << (a & 7);
+            }
+        }
+        i += length;
+    }
+}
+
+/** Bring the DMP memory left by a previous dmpInitialize() back to dmpMemory[].
+ * Compares every bank with the code byte by byte, except the bytes that the
+ * configuration set and the memory updates write after the upload anyway,
+ * and uploads the banks that differ: code corrupted or variables the DMP
+ * changed while it ran.
+ * @return False if an upload failed its verification
+ */
+static bool dmpRestoreMemory(MPU6050 *mpu) {
+    uint8_t written[MPU6050_DMP_MEMORY_BANK_SIZE / 8];
+    uint8_t chunk[MPU6050_DMP_MEMORY_BURST_SIZE];
+
+    for (uint8_t bank = 0; bank * MPU6050_DMP_MEMORY_BANK_SIZE < MPU6050_DMP_CODE_SIZE; bank++) {
+        const unsigned char *code = dmpMemory + bank * MPU6050_DMP_MEMORY_BANK_SIZE;
+        uint16_t size = MPU6050_DMP_CODE_SIZE - bank * MPU6050_DMP_MEMORY_BANK_SIZE;
+        if (size > MPU6050_DMP_MEMORY_BANK_SIZE) size = MPU6050_DMP_MEMORY_BANK_SIZE;
+
+        memset(written, 0, sizeof(written));
+        dmpMarkWritten(dmpConfig, MPU6050_DMP_CONFIG_SIZE, bank, 0xFF, written);
+        dmpMarkWritten(dmpUpdates, MPU6050_DMP_UPDATES_SIZE, bank, MPU6050_DMP_UPDATE_READ, written);
+
+        bool loaded = true;
+        for (uint16_t address = 0; address < size && loaded; address += sizeof(chunk)) {
+            uint8_t chunkSize = size - address < sizeof(chunk) ? size - address : sizeof(chunk);
+            mpu->readMemoryBlock(chunk, chunkSize, bank, address);
+            for (uint8_t i = 0; i < chunkSize; i++) {
+                uint8_t a = address + i;
+                if (!(written[a >> 3] & (1 << (a & 7))) && chunk[i] != pgm_read_byte(code + a)) {
+                    loaded = false;
+                    break;
+                }
+            }
+        }
+
+        if (!loaded) {
+            DEBUG_PRINT(F("Bank "));
+            DEBUG_PRINT(bank);
+            DEBUG_PRINTLN(F(" differs, writing it again..."));
+            if (!mpu->writeProgMemoryBlock(code, size, bank)) return false;
+        }
+    }
+    return true;
+}
+
+uint8_t MPU6050::dmpInitialize(bool warmStart) {
+    // after a reset of the Arduino alone the MPU6050 still holds the DMP
+    // memory this sketch loaded, but initialize() has reset the registers
+    // (gyro range, rate, DLPF, interrupts, FIFO): with warmStart only the
+    // upload of the code is skipped, the configuration below runs either way
+    bool restore = warmStart && getDMPEnabled();
+
+    if (restore) {
+        DEBUG_PRINTLN(F("DMP enabled, keeping its memory..."));
+        setDMPEnabled(false);
+    } else {
+        // reset device
+        DEBUG_PRINTLN(F("\n\nResetting MPU6050..."));
+        reset();
+        delay(30); // wait after reset
+    }
 
     // enable sleep mode and wake cycle
     /*Serial.println(F("Enabling sleep mode..."));
@@ -336,10 +419,17 @@ uint8_t MPU6050::dmpInitialize() {
     delay(20);
 
     // load DMP code into memory banks
-    DEBUG_PRINT(F("Writing DMP code to MPU memory banks ("));
-    DEBUG_PRINT(MPU6050_DMP_CODE_SIZE);
-    DEBUG_PRINTLN(F(" bytes)"));
-    if (writeProgMemoryBlock(dmpMemory, MPU6050_DMP_CODE_SIZE)) {
+    bool codeLoaded;
+    if (restore) {
+        DEBUG_PRINTLN(F("Comparing the DMP code in the MPU memory banks..."));
+        codeLoaded = dmpRestoreMemory(this);
+    } else {
+        DEBUG_PRINT(F("Writing DMP code to MPU memory banks ("));
+        DEBUG_PRINT(MPU6050_DMP_CODE_SIZE);
+        DEBUG_PRINTLN(F(" bytes)"));
+        codeLoaded = writeProgMemoryBlock(dmpMemory, MPU6050_DMP_CODE_SIZE);
+    }
+    if (codeLoaded) {
         DEBUG_PRINTLN(F("Success! DMP code written and verified."));
 
         // write DMP configuration
@@ -484,7 +574,7 @@ uint8_t MPU6050::dmpInitialize() {
             setDMPEnabled(false);
 
             DEBUG_PRINTLN(F("Setting up internal 42-byte (default) DMP packet buffer..."));
-            dmpPacketSize = 42;
+            dmpPacketSize = MPU6050_DMP_PACKET_SIZE;
             /*if ((dmpPacketBuffer = (uint8_t *)malloc(42)) == 0) {
                 return 3; // TODO: proper error code for no memory
             }*/
@@ -0,0 +1,259 @@
+// Host program comparing helper_3dmath_fixed.h with the float helper_3dmath.h:
+// accuracy against a double reference and throughput of the basic operations.
+// Not part of the Arduino library build (extras/ is not compiled), build it
+// on the host:
+//     g++ -O2 -I.. helper_3dmath_bench.cpp -o helper_3dmath_bench
+//     ./helper_3dmath_bench
+// The throughput numbers are for comparing changes to the fixed point code,
+// a PC has an FPU and a 64 bit multiplier. On an AVR every float operation is
+// emulated in software, which is what the fixed point version avoids; the
+// sketch in helper_3dmath_cycles counts the cycles there.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "helper_3dmath.h"
+#include "helper_3dmath_fixed.h"
+
+#define GYRO_RATE 800
+#define SECONDS 60
+#define SENSITIVITY 0.070 // dps per LSB at 2000 dps
+#define ITERATIONS 2000000
+
+struct QuaternionD {
+    double w, x, y, z;
+
+    QuaternionD getProduct(const QuaternionD &q) const {
+        QuaternionD r = {
+            w*q.w - x*q.x - y*q.y - z*q.z,
+            w*q.x + x*q.w + y*q.z - z*q.y,
+            w*q.y - x*q.z + y*q.w + z*q.x,
+            w*q.z + x*q.y - y*q.x + z*q.w };
+        return r;
+    }
+};
+
+static double random(double min, double max) {
+    return min + (max - min) * rand() / RAND_MAX;
+}
+
+static double toDouble(int32_t q30) {
+    return q30 / (double) Q30_ONE;
+}
+
+// Angle in degrees between two orientations
+static double angleBetween(const QuaternionD &a, double w, double x, double y, double z) {
+    double dot = fabs(a.w*w + a.x*x + a.y*y + a.z*z) / sqrt(w*w + x*x + y*y + z*z);
+    return 2 * acos(dot > 1 ? 1 : dot) * 180 / M_PI;
+}
+
+static double seconds(clock_t start) {
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+// Integrates a random head motion like the firmware does, with exact
+// rotations in double as the reference
+static void integrationAccuracy() {
+    QuaternionD reference = { 1, 0, 0, 0 };
+    Quaternion floatQ;
+    QuaternionQ30 fixedQ;
+    double maxFloat = 0, maxFixed = 0;
+    double dt = 1.0 / GYRO_RATE;
+    int16_t raw[3] = { 0, 0, 0 };
+    int32_t halfAngle = (int32_t) (SENSITIVITY * (M_PI / 180.0) * 0.5 * dt * ((double) Q30_ONE * 16));
+
+    srand(1);
+
+    for (long i = 0; i < (long) SECONDS * GYRO_RATE; i++) {
+        // new angular velocity every 50 ms, up to 600 dps
+        if (i % (GYRO_RATE / 20) == 0) {
+            for (int axis = 0; axis < 3; axis++) {
+                raw[axis] = (int16_t) (random(-600, 600) / SENSITIVITY);
+            }
+        }
+
+        double h[3];
+        for (int axis = 0; axis < 3; axis++) {
+            h[axis] = raw[axis] * SENSITIVITY * (M_PI / 180.0) * 0.5 * dt;
+        }
+
+        double length = sqrt(h[0]*h[0] + h[1]*h[1] + h[2]*h[2]);
+        double s = length > 0 ? sin(length) / length : 1;
+        QuaternionD delta = { cos(length), h[0] * s, h[1] * s, h[2] * s };
+        reference = reference.getProduct(delta);
+
+        float hw = 1 - (float) (length * length) / 2;
+        floatQ = floatQ.getProduct(Quaternion(hw, (float) h[0], (float) h[1], (float) h[2]));
+
+        int32_t hx = ((int32_t) raw[0] * halfAngle) >> 4;
+        int32_t hy = ((int32_t) raw[1] * halfAngle) >> 4;
+        int32_t hz = ((int32_t) raw[2] * halfAngle) >> 4;
+        int32_t fw = Q30_ONE - (q30Mul(hx, hx) + q30Mul(hy, hy) + q30Mul(hz, hz)) / 2;
+        fixedQ = fixedQ.getProduct(QuaternionQ30(fw, hx, hy, hz));
+
+        // as the firmware: renormalize once per packet of 4 samples
+        if (i % 4 == 3) {
+            floatQ.normalize();
+            fixedQ.renormalize();
+        }
+
+        double floatError = angleBetween(reference, floatQ.w, floatQ.x, floatQ.y, floatQ.z);
+        double fixedError = angleBetween(reference, toDouble(fixedQ.w), toDouble(fixedQ.x), toDouble(fixedQ.y), toDouble(fixedQ.z));
+        maxFloat = floatError > maxFloat ? floatError : maxFloat;
+        maxFixed = fixedError > maxFixed ? fixedError : maxFixed;
+    }
+
+    printf("integration, %d s at %d Hz, max error against double:\n", SECONDS, GYRO_RATE);
+    printf("  float %.5f deg, Q30 %.5f deg\n", maxFloat, maxFixed);
+}
+
+static void rotationAccuracy() {
+    double maxFloat = 0, maxFixed = 0;
+
+    srand(2);
+
+    for (int i = 0; i < 100000; i++) {
+        QuaternionD q = { random(-1, 1), random(-1, 1), random(-1, 1), random(-1, 1) };
+        double m = sqrt(q.w*q.w + q.x*q.x + q.y*q.y + q.z*q.z);
+        q.w /= m; q.x /= m; q.y /= m; q.z /= m;
+        // keep the length at 16384 so no rotated component saturates
+        double v[3] = { random(-1, 1), random(-1, 1), random(-1, 1) };
+        double vm = sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]) / 16384;
+        int16_t raw[3] = { (int16_t) (v[0] / vm), (int16_t) (v[1] / vm), (int16_t) (v[2] / vm) };
+
+        QuaternionD p = { 0, (double) raw[0], (double) raw[1], (double) raw[2] };
+        QuaternionD conjugate = { q.w, -q.x, -q.y, -q.z };
+        QuaternionD r = q.getProduct(p).getProduct(conjugate);
+
+        Quaternion floatQ((float) q.w, (float) q.x, (float) q.y, (float) q.z);
+        VectorFloat floatV(raw[0], raw[1], raw[2]);
+        floatV.rotate(&floatQ);
+
+        QuaternionQ30 fixedQ((int32_t) (q.w * Q30_ONE), (int32_t) (q.x * Q30_ONE), (int32_t) (q.y * Q30_ONE), (int32_t) (q.z * Q30_ONE));
+        VectorQ15 fixedV(raw[0], raw[1], raw[2]);
+        fixedV.rotate(fixedQ);
+
+        double floatError = fabs(floatV.x - r.x) + fabs(floatV.y - r.y) + fabs(floatV.z - r.z);
+        double fixedError = fabs(fixedV.x - r.x) + fabs(fixedV.y - r.y) + fabs(fixedV.z - r.z);
+        maxFloat = floatError > maxFloat ? floatError : maxFloat;
+        maxFixed = fixedError > maxFixed ? fixedError : maxFixed;
+    }
+
+    printf("rotation of int16 vectors (length 16384), max summed error:\n");
+    printf("  float %.3f LSB, Q30/int16 %.3f LSB\n", maxFloat, maxFixed);
+}
+
+static void normalizationAccuracy() {
+    double maxExact = 0, maxNewton = 0;
+
+    srand(3);
+
+    for (int i = 0; i < 100000; i++) {
+        double q[4] = { random(-1, 1), random(-1, 1), random(-1, 1), random(-1, 1) };
+        double m = sqrt(q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
+        // exact: any length in [0.5, 1.5); Newton step: drift of integration
+        double exactScale = random(0.5, 1.5) / m, newtonScale = random(0.999, 1.001) / m;
+
+        QuaternionQ30 exact((int32_t) (q[0] * exactScale * Q30_ONE), (int32_t) (q[1] * exactScale * Q30_ONE),
+                (int32_t) (q[2] * exactScale * Q30_ONE), (int32_t) (q[3] * exactScale * Q30_ONE));
+        QuaternionQ30 newton((int32_t) (q[0] * newtonScale * Q30_ONE), (int32_t) (q[1] * newtonScale * Q30_ONE),
+                (int32_t) (q[2] * newtonScale * Q30_ONE), (int32_t) (q[3] * newtonScale * Q30_ONE));
+        exact.normalize();
+        newton.renormalize();
+
+        double exactError = fabs(sqrt(toDouble(exact.getMagnitudeSquared())) - 1);
+        double newtonError = fabs(sqrt(toDouble(newton.getMagnitudeSquared())) - 1);
+        maxExact = exactError > maxExact ? exactError : maxExact;
+        maxNewton = newtonError > maxNewton ? newtonError : maxNewton;
+    }
+
+    printf("normalization, max |length - 1|:\n");
+    printf("  normalize() %.2e (length 0.5-1.5), renormalize() %.2e (length 1 +- 0.001)\n", maxExact, maxNewton);
+}
+
+// Inputs vary per iteration so nothing is hoisted out of the loops
+#define INPUTS 256
+
+static void throughput() {
+    static Quaternion floatQ[INPUTS];
+    static QuaternionQ30 fixedQ[INPUTS];
+    static VectorFloat floatV[INPUTS];
+    static VectorQ15 fixedV[INPUTS];
+    volatile float floatSink = 0;
+    volatile int32_t fixedSink = 0;
+    clock_t start;
+
+    srand(4);
+
+    for (int i = 0; i < INPUTS; i++) {
+        QuaternionD q = { random(-1, 1), random(-1, 1), random(-1, 1), random(-1, 1) };
+        // lengths around 1 as in the integration
+        double m = sqrt(q.w*q.w + q.x*q.x + q.y*q.y + q.z*q.z) / random(0.999, 1.001);
+        floatQ[i] = Quaternion((float) (q.w / m), (float) (q.x / m), (float) (q.y / m), (float) (q.z / m));
+        fixedQ[i] = QuaternionQ30((int32_t) (q.w / m * Q30_ONE), (int32_t) (q.x / m * Q30_ONE),
+                (int32_t) (q.y / m * Q30_ONE), (int32_t) (q.z / m * Q30_ONE));
+        int16_t v[3] = { (int16_t) random(-16384, 16384), (int16_t) random(-16384, 16384), (int16_t) random(-16384, 16384) };
+        floatV[i] = VectorFloat(v[0], v[1], v[2]);
+        fixedV[i] = VectorQ15(v[0], v[1], v[2]);
+    }
+
+    printf("throughput, ns per operation (float / Q30):\n");
+
+    start = clock();
+    for (long i = 0; i < ITERATIONS; i++) {
+        floatSink = floatQ[i % INPUTS].getProduct(floatQ[(i * 7 + 1) % INPUTS]).w;
+    }
+    double floatProduct = seconds(start);
+    start = clock();
+    for (long i = 0; i < ITERATIONS; i++) {
+        fixedSink = fixedQ[i % INPUTS].getProduct(fixedQ[(i * 7 + 1) % INPUTS]).w;
+    }
+    double fixedProduct = seconds(start);
+    printf("  getProduct  %6.1f / %6.1f\n", floatProduct * 1e9 / ITERATIONS, fixedProduct * 1e9 / ITERATIONS);
+
+    start = clock();
+    for (long i = 0; i < ITERATIONS; i++) {
+        floatSink = floatQ[i % INPUTS].getNormalized().w;
+    }
+    double floatNormalize = seconds(start);
+    start = clock();
+    for (long i = 0; i < ITERATIONS; i++) {
+        fixedSink = fixedQ[i % INPUTS].getNormalized().w;
+    }
+    double fixedNormalize = seconds(start);
+    start = clock();
+    for (long i = 0; i < ITERATIONS; i++) {
+        QuaternionQ30 q = fixedQ[i % INPUTS];
+        q.renormalize();
+        fixedSink = q.w;
+    }
+    double fixedRenormalize = seconds(start);
+    printf("  normalize   %6.1f / %6.1f (renormalize %.1f)\n", floatNormalize * 1e9 / ITERATIONS,
+            fixedNormalize * 1e9 / ITERATIONS, fixedRenormalize * 1e9 / ITERATIONS);
+
+    start = clock();
+    for (long i = 0; i < ITERATIONS; i++) {
+        floatSink = floatV[i % INPUTS].getRotated(&floatQ[(i * 7 + 1) % INPUTS]).x;
+    }
+    double floatRotate = seconds(start);
+    start = clock();
+    for (long i = 0; i < ITERATIONS; i++) {
+        fixedSink = fixedV[i % INPUTS].getRotated(fixedQ[(i * 7 + 1) % INPUTS]).x;
+    }
+    double fixedRotate = seconds(start);
+    printf("  rotate      %6.1f / %6.1f\n", floatRotate * 1e9 / ITERATIONS, fixedRotate * 1e9 / ITERATIONS);
+
+    (void) floatSink;
+    (void) fixedSink;
+}
+
+int main() {
+    integrationAccuracy();
+    rotationAccuracy();
+    normalizationAccuracy();
+    throughput();
+    return 0;
+}
@@ -0,0 +1,101 @@
+// AVR counterpart of helper_3dmath_bench.cpp: CPU cycles per operation of
+// helper_3dmath_fixed.h and the float helper_3dmath.h, counted with Timer1
+// at the CPU clock. Open it in the Arduino IDE (extras/ is not compiled with
+// the library), upload and read the counts at 115200 baud.
+// The firmware integrates one getProduct per gyro sample and one renormalize
+// per packet: at 800 Hz and 16 MHz a sample has 20000 cycles.
+
+#include "helper_3dmath.h"
+#include "helper_3dmath_fixed.h"
+
+// volatile inputs and sinks so nothing is folded or hoisted
+volatile float floatIn[4] = { 0.7071f, 0.5f, -0.3f, 0.4f };
+volatile int32_t fixedIn[4] = { 759250125L, 536870912L, -322122547L, 429496730L };
+volatile int16_t vectorIn[3] = { 12000, -8000, 4000 };
+volatile float floatSink;
+volatile int32_t fixedSink;
+
+#define REPEAT 16
+
+static uint16_t overhead;
+
+static inline void startCount() {
+  TCNT1 = 0;
+}
+
+static inline uint16_t stopCount() {
+  return TCNT1;
+}
+
+static Quaternion floatQuaternion() {
+  return Quaternion(floatIn[0], floatIn[1], floatIn[2], floatIn[3]);
+}
+
+static QuaternionQ30 fixedQuaternion() {
+  return QuaternionQ30(fixedIn[0], fixedIn[1], fixedIn[2], fixedIn[3]);
+}
+
+// 0 for an operation without a float counterpart
+static void report(const char *name, uint16_t floatCycles, uint16_t fixedCycles) {
+  Serial.print(name);
+  Serial.print('\t');
+  if (floatCycles) {
+    Serial.print(floatCycles);
+  }
+  else {
+    Serial.print('-');
+  }
+  Serial.print('\t');
+  Serial.println(fixedCycles);
+}
+
+// Minimum over REPEAT runs of one statement, less the cost of loading the
+// inputs and storing the result
+#define COUNT(result, statement) do { \
+    result = 0xFFFF; \
+    for (uint8_t i = 0; i < REPEAT; i++) { \
+      startCount(); \
+      statement; \
+      uint16_t c = stopCount(); \
+      result = c < result ? c : result; \
+    } \
+    result -= overhead; \
+  } while (0)
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial);
+
+  // Timer1 free running at the CPU clock, no interrupts
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+  TIMSK1 = 0;
+
+  uint16_t floatCycles, fixedCycles;
+
+  overhead = 0;
+  COUNT(overhead, fixedSink = fixedIn[0]);
+
+  Serial.println(F("cycles per operation\tfloat\tQ30"));
+
+  COUNT(floatCycles, floatSink = floatQuaternion().getProduct(floatQuaternion()).w);
+  COUNT(fixedCycles, fixedSink = fixedQuaternion().getProduct(fixedQuaternion()).w);
+  report("getProduct", floatCycles, fixedCycles);
+
+  COUNT(floatCycles, floatSink = floatQuaternion().getNormalized().w);
+  COUNT(fixedCycles, fixedSink = fixedQuaternion().getNormalized().w);
+  report("normalize", floatCycles, fixedCycles);
+
+  COUNT(fixedCycles, QuaternionQ30 q = fixedQuaternion(); q.renormalize(); fixedSink = q.w);
+  report("renormalize", 0, fixedCycles);
+
+  COUNT(floatCycles, Quaternion q = floatQuaternion(); VectorFloat v(vectorIn[0], vectorIn[1], vectorIn[2]); v.rotate(&q); floatSink = v.x);
+  COUNT(fixedCycles, VectorQ15 v(vectorIn[0], vectorIn[1], vectorIn[2]); v.rotate(fixedQuaternion()); fixedSink = v.x);
+  report("rotate", floatCycles, fixedCycles);
+
+  COUNT(fixedCycles, fixedSink = q30Mul(fixedIn[0], fixedIn[1]));
+  report("q30Mul", 0, fixedCycles);
+}
+
+void loop() {
+}
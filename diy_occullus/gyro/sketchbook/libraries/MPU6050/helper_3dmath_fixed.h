@@ -0,0 +1,229 @@
+// I2C device class (I2Cdev) demonstration Arduino sketch for MPU6050 class, 3D math helper
+// Fixed point counterpart of helper_3dmath.h for AVRs without an FPU
+
+/* ============================================
+I2Cdev device library code is placed under the MIT license
+Copyright (c) 2012 Jeff Rowberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+===============================================
+*/
+
+#ifndef _HELPER_3DMATH_FIXED_H_
+#define _HELPER_3DMATH_FIXED_H_
+
+#include <stdint.h>
+
+// Q30: 1.0 is 2^30, leaves one integer bit and the sign for values in [-2, 2),
+// used for quaternion components and intermediate products
+#define Q30_ONE 0x40000000L
+// Q15: 1.0 is 2^15, values in [-1, 1) stored in int16_t
+#define Q15_ONE 0x8000L
+
+// Limits spelled out, avr-libc only defines INT32_MAX etc. for C++ with
+// __STDC_LIMIT_MACROS
+#define FIXED_INT32_MAX 0x7FFFFFFFL
+#define FIXED_INT32_MIN (-FIXED_INT32_MAX - 1)
+#define FIXED_INT16_MAX 32767
+#define FIXED_INT16_MIN (-32768)
+
+// All results saturate instead of wrapping around, a rotation that is
+// slightly off is better than one with a flipped sign. Sums of products are
+// kept in Q60 and saturated once: on an AVR every int64 shift and compare is
+// a libgcc call, so they are paid per result rather than per term
+inline int32_t saturate32(int64_t v) {
+    return v > FIXED_INT32_MAX ? FIXED_INT32_MAX : (v < FIXED_INT32_MIN ? FIXED_INT32_MIN : (int32_t) v);
+}
+
+inline int16_t saturate16(int32_t v) {
+    return v > FIXED_INT16_MAX ? FIXED_INT16_MAX : (v < FIXED_INT16_MIN ? FIXED_INT16_MIN : (int16_t) v);
+}
+
+inline int32_t q30Add(int32_t a, int32_t b) {
+    return saturate32((int64_t) a + b);
+}
+
+inline int32_t q30Sub(int32_t a, int32_t b) {
+    return saturate32((int64_t) a - b);
+}
+
+inline int32_t q30Mul(int32_t a, int32_t b) {
+    return saturate32(((int64_t) a * b) >> 30);
+}
+
+// Full product of two Q30 values in Q60, a 32x32->64 bit multiply
+inline int64_t q60Mul(int32_t a, int32_t b) {
+    return (int64_t) a * b;
+}
+
+inline int32_t q60ToQ30(int64_t v) {
+    return saturate32(v >> 30);
+}
+
+inline int16_t q15Mul(int16_t a, int16_t b) {
+    return saturate16(((int32_t) a * b) >> 15);
+}
+
+// Integer square root, floor(sqrt(v))
+inline uint32_t isqrt64(uint64_t v) {
+    uint64_t result = 0;
+    uint64_t bit = (uint64_t) 1 << 62;
+
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (v >= result + bit) {
+            v -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t) result;
+}
+
+class QuaternionQ30 {
+    public:
+        int32_t w;
+        int32_t x;
+        int32_t y;
+        int32_t z;
+
+        QuaternionQ30() {
+            w = Q30_ONE;
+            x = 0;
+            y = 0;
+            z = 0;
+        }
+
+        QuaternionQ30(int32_t nw, int32_t nx, int32_t ny, int32_t nz) {
+            w = nw;
+            x = nx;
+            y = ny;
+            z = nz;
+        }
+
+        // Same as Quaternion::getProduct. Each component is a dot product of
+        // the two quaternions (up to signs), so neither it nor a partial sum
+        // leaves the int64 range while |this| * |q| < 8
+        QuaternionQ30 getProduct(const QuaternionQ30 &q) const {
+            return QuaternionQ30(
+                q60ToQ30(q60Mul(w, q.w) - q60Mul(x, q.x) - q60Mul(y, q.y) - q60Mul(z, q.z)),  // new w
+                q60ToQ30(q60Mul(w, q.x) + q60Mul(x, q.w) + q60Mul(y, q.z) - q60Mul(z, q.y)),  // new x
+                q60ToQ30(q60Mul(w, q.y) - q60Mul(x, q.z) + q60Mul(y, q.w) + q60Mul(z, q.x)),  // new y
+                q60ToQ30(q60Mul(w, q.z) + q60Mul(x, q.y) - q60Mul(y, q.x) + q60Mul(z, q.w))); // new z
+        }
+
+        QuaternionQ30 getConjugate() const {
+            return QuaternionQ30(w, -x, -y, -z);
+        }
+
+        // Squared magnitude in Q30, the unsigned Q60 sum cannot wrap
+        int32_t getMagnitudeSquared() const {
+            uint64_t n = (uint64_t) q60Mul(w, w) + (uint64_t) q60Mul(x, x)
+                    + (uint64_t) q60Mul(y, y) + (uint64_t) q60Mul(z, z);
+            n >>= 30;
+            return n > (uint64_t) FIXED_INT32_MAX ? FIXED_INT32_MAX : (int32_t) n;
+        }
+
+        // Exact, uses 64 bit division: call it rarely on an AVR
+        void normalize() {
+            uint64_t n = (uint64_t) q60Mul(w, w) + (uint64_t) q60Mul(x, x)
+                    + (uint64_t) q60Mul(y, y) + (uint64_t) q60Mul(z, z);
+            int64_t m = isqrt64(n);
+            if (m == 0) {
+                return;
+            }
+            w = saturate32(((int64_t) w << 30) / m);
+            x = saturate32(((int64_t) x << 30) / m);
+            y = saturate32(((int64_t) y << 30) / m);
+            z = saturate32(((int64_t) z << 30) / m);
+        }
+
+        // One Newton step towards unit length, 1/sqrt(n) ~ (3 - n) / 2, which
+        // only holds close to unit length: call it after every few products
+        void renormalize() {
+            int32_t n = getMagnitudeSquared();
+            int32_t f = q30Add(Q30_ONE, q30Sub(Q30_ONE, n) / 2);
+            w = q30Mul(w, f);
+            x = q30Mul(x, f);
+            y = q30Mul(y, f);
+            z = q30Mul(z, f);
+        }
+
+        QuaternionQ30 getNormalized() const {
+            QuaternionQ30 r(w, x, y, z);
+            r.normalize();
+            return r;
+        }
+};
+
+// Vector of int16_t, either Q15 (unit vectors) or raw sensor values: rotating
+// does not depend on the scale
+class VectorQ15 {
+    public:
+        int16_t x;
+        int16_t y;
+        int16_t z;
+
+        VectorQ15() {
+            x = 0;
+            y = 0;
+            z = 0;
+        }
+
+        VectorQ15(int16_t nx, int16_t ny, int16_t nz) {
+            x = nx;
+            y = ny;
+            z = nz;
+        }
+
+        // Dot product in the squared scale, e.g. Q30 for two Q15 vectors
+        int32_t dot(const VectorQ15 &v) const {
+            return saturate32((int64_t) x * v.x + (int64_t) y * v.y + (int64_t) z * v.z);
+        }
+
+        // Same result as VectorInt16::rotate, but with
+        //     t = 2 * cross(q.xyz, v), v' = v + q.w * t + cross(q.xyz, t)
+        // which needs 15 instead of 32 multiplications. t and v' keep 12
+        // fraction bits, so the result is off by at most one LSB. t fits in
+        // int32 for a unit q, so every multiply is 32x32->64
+        void rotate(const QuaternionQ30 &q) {
+            int32_t tx = (int32_t) ((q60Mul(q.y, z) - q60Mul(q.z, y)) >> 17);
+            int32_t ty = (int32_t) ((q60Mul(q.z, x) - q60Mul(q.x, z)) >> 17);
+            int32_t tz = (int32_t) ((q60Mul(q.x, y) - q60Mul(q.y, x)) >> 17);
+            int64_t rx = ((int64_t) x << 12) + ((q60Mul(q.w, tx) + q60Mul(q.y, tz) - q60Mul(q.z, ty)) >> 30);
+            int64_t ry = ((int64_t) y << 12) + ((q60Mul(q.w, ty) + q60Mul(q.z, tx) - q60Mul(q.x, tz)) >> 30);
+            int64_t rz = ((int64_t) z << 12) + ((q60Mul(q.w, tz) + q60Mul(q.x, ty) - q60Mul(q.y, tx)) >> 30);
+            x = saturate16((int32_t) ((rx + 2048) >> 12));
+            y = saturate16((int32_t) ((ry + 2048) >> 12));
+            z = saturate16((int32_t) ((rz + 2048) >> 12));
+        }
+
+        VectorQ15 getRotated(const QuaternionQ30 &q) const {
+            VectorQ15 r(x, y, z);
+            r.rotate(q);
+            return r;
+        }
+};
+
+#endif /* _HELPER_3DMATH_FIXED_H_ */